@@ -2,6 +2,7 @@
 #include "particle.hpp"
 
 #include <thread>
+#include <random>
 #include <wayfire/output.hpp>
 #include <wayfire/core.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,9 +13,12 @@ static wf::option_wrapper_t<bool> random_fire_color{"animate/random_fire_color"}
 static wf::option_wrapper_t<wf::color_t> fire_color{"animate/fire_color"};
 
 // generate a random float between s and e
+// particles are initialized on the worker threads, so each thread has its own
+// generator instead of sharing the state of std::rand()
 static float random(float s, float e)
 {
-    double r = 1.0 * (std::rand() % RAND_MAX) / (RAND_MAX - 1);
+    thread_local std::minstd_rand generator{std::random_device{}()};
+    double r = std::uniform_real_distribution<double>{0.0, 1.0}(generator);
 
     return (s * r + (1 - r) * e);
 }
@@ -1,53 +1,32 @@
 #include "particle.hpp"
 #include "shaders.hpp"
 #include <wayfire/core.hpp>
-#include <thread>
+#include <wayfire/worker-pool.hpp>
+#include <cmath>
 
-void Particle::update(float time)
-{
-    if (life <= 0) // ignore
-    {
-        return;
-    }
-
-    const float slowdown = 0.8;
-
-    pos   += speed * 0.2f * slowdown;
-    speed += g * 0.3f * slowdown;
-
-    if (life != 0)
-    {
-        color.a /= life;
-    }
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
-    life    -= fade * 0.3 * slowdown;
-    radius   = base_radius * std::pow(life, 0.5);
-    color.a *= life;
-
-    if (start_pos.x < pos.x)
-    {
-        g.x = -1;
-    } else
-    {
-        g.x = 1;
-    }
+namespace
+{
+const float slowdown   = 0.8;
+const float move_step  = 0.2 * slowdown;
+const float speed_step = 0.3 * slowdown;
+const float fade_step  = 0.3 * slowdown;
 
-    if (life <= 0)
-    {
-        /* move outside */
-        pos = {-10000, -10000};
-    }
+/* Dead particles are moved outside of the visible area */
+const float outside_pos = -10000;
 }
 
 ParticleSystem::ParticleSystem(int particles, ParticleIniter init_func)
 {
     this->pinit_func = init_func;
 
+    particles_alive.store(0);
     resize(particles);
     last_update_msec = wf::get_current_time();
     create_program();
-
-    particles_alive.store(0);
 }
 
 ParticleSystem::~ParticleSystem()
@@ -57,105 +36,212 @@ ParticleSystem::~ParticleSystem()
     OpenGL::render_end();
 }
 
+void ParticleSystem::store_particle(size_t i, const Particle& p)
+{
+    life[i] = p.life;
+    fade[i] = p.fade;
+    base_radius[i] = p.base_radius;
+    radius[i] = p.radius;
+
+    center[2 * i]     = p.pos.x;
+    center[2 * i + 1] = p.pos.y;
+    speed_x[i] = p.speed.x;
+    speed_y[i] = p.speed.y;
+    g_x[i]     = p.g.x;
+    g_y[i]     = p.g.y;
+    start_x[i] = p.start_pos.x;
+
+    color[3 * i]     = p.color.r;
+    color[3 * i + 1] = p.color.g;
+    color[3 * i + 2] = p.color.b;
+    alpha[i] = p.color.a;
+}
+
 int ParticleSystem::spawn(int num)
 {
-    // TODO: multithread this
-    int spawned = 0;
-    for (size_t i = 0; i < ps.size() && spawned < num; i++)
+    std::atomic<int> spawned{0};
+    wf::worker_pool_t::get().parallel_for(size(), particles_per_chunk,
+        [&] (size_t start, size_t end)
     {
-        if (ps[i].life <= 0)
+        for (size_t i = start; i < end && spawned < num; i++)
         {
-            pinit_func(ps[i]);
-            ++spawned;
-            ++particles_alive;
+            if ((life[i] <= 0) && (spawned++ < num))
+            {
+                Particle p;
+                pinit_func(p);
+                store_particle(i, p);
+                ++particles_alive;
+            }
         }
-    }
+    });
 
-    return spawned;
+    return std::min(spawned.load(), num);
 }
 
 void ParticleSystem::resize(int num)
 {
-    if (num == (int)ps.size())
+    if (num == size())
     {
         return;
     }
 
-    // TODO: multithread this
-    for (int i = num; i < (int)ps.size(); i++)
+    if (num < size())
     {
-        if (ps[i].life >= 0)
+        wf::worker_pool_t::get().parallel_for(size() - num,
+            particles_per_chunk, [&] (size_t start, size_t end)
         {
-            --particles_alive;
-        }
+            int removed = 0;
+            for (size_t i = num + start; i < num + end; i++)
+            {
+                removed += (life[i] > 0);
+            }
+
+            particles_alive -= removed;
+        });
     }
 
-    ps.resize(num);
-
-    color.resize(color_per_particle * num);
-    dark_color.resize(color_per_particle * num);
-    radius.resize(radius_per_particle * num);
-    center.resize(center_per_particle * num);
+    /* New particles are dead until they are spawned */
+    life.resize(num, -1);
+    fade.resize(num, 0);
+    base_radius.resize(num, 0);
+    radius.resize(num, 0);
+
+    center.resize(center_per_particle * num, outside_pos);
+    speed_x.resize(num, 0);
+    speed_y.resize(num, 0);
+    g_x.resize(num, 0);
+    g_y.resize(num, 0);
+    start_x.resize(num, 0);
+
+    color.resize(color_per_particle * num, 0);
+    alpha.resize(num, 0);
 }
 
 int ParticleSystem::size()
 {
-    return ps.size();
+    return life.size();
 }
 
-void ParticleSystem::update_worker(float time, int start, int end)
+int ParticleSystem::update_particle(size_t i)
 {
-    end = std::min(end, (int)ps.size());
-    for (int i = start; i < end; ++i)
+    if (life[i] <= 0)
     {
-        if (ps[i].life <= 0)
-        {
-            continue;
-        }
+        return 0;
+    }
 
-        // printf("%d\n", i);
-        ps[i].update(time);
+    float& x = center[2 * i];
+    float& y = center[2 * i + 1];
 
-        if (ps[i].life <= 0)
-        {
-            --particles_alive;
-        }
+    x += speed_x[i] * move_step;
+    y += speed_y[i] * move_step;
+    speed_x[i] += g_x[i] * speed_step;
+    speed_y[i] += g_y[i] * speed_step;
 
-        for (int j = 0; j < 4; j++) // maybe use memcpy?
-        {
-            color[4 * i + j] = ps[i].color[j];
-            dark_color[4 * i + j] = ps[i].color[j] * 0.5;
-        }
+    float new_life = life[i] - fade[i] * fade_step;
+    alpha[i] *= new_life / life[i];
+    life[i]   = new_life;
+    radius[i] = base_radius[i] * std::sqrt(std::max(new_life, 0.0f));
 
-        // printf("center %d gets %f", 2 * i, ps[i].pos[0]);
-        center[2 * i]     = ps[i].pos[0];
-        center[2 * i + 1] = ps[i].pos[1];
+    g_x[i] = (start_x[i] < x) ? -1 : 1;
 
-        radius[i] = ps[i].radius;
+    if (new_life <= 0)
+    {
+        x = y = outside_pos;
+        radius[i] = 0;
+
+        return 1;
     }
+
+    return 0;
 }
 
-void ParticleSystem::exec_worker_threads(std::function<void(int, int)> spawn_worker)
+int ParticleSystem::update_worker(float time, size_t start, size_t end)
 {
-// return spawn_worker(0, ps.size());
-
-    const int num_threads = std::thread::hardware_concurrency();
-    const int worker_load = (ps.size() + num_threads - 1) / num_threads;
+    int died = 0;
+    size_t i = start;
+
+#if defined(__SSE2__)
+    const __m128 zero  = _mm_setzero_ps();
+    const __m128 one   = _mm_set1_ps(1);
+    const __m128 minus_one = _mm_set1_ps(-1);
+    const __m128 outside   = _mm_set1_ps(outside_pos);
+    const __m128 move  = _mm_set1_ps(move_step);
+    const __m128 accel = _mm_set1_ps(speed_step);
+    const __m128 fade_speed = _mm_set1_ps(fade_step);
+
+    /* Select a where mask is set, b otherwise */
+    const auto select = [] (__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    };
 
-    std::thread workers[num_threads];
-    for (int i = 0; i < num_threads; i++)
+    for (; i + 4 <= end; i += 4)
     {
-        int thread_start = i * worker_load;
-        int thread_end   = (i + 1) * worker_load;
-        thread_end = std::min(thread_end, (int)ps.size());
+        __m128 old_life = _mm_loadu_ps(&life[i]);
+        __m128 alive    = _mm_cmpgt_ps(old_life, zero);
+        if (_mm_movemask_ps(alive) == 0)
+        {
+            continue;
+        }
 
-        workers[i] = std::thread([=] () { spawn_worker(thread_start, thread_end); });
+        /* Deinterleave the positions of the 4 particles */
+        __m128 c0 = _mm_loadu_ps(&center[2 * i]);
+        __m128 c1 = _mm_loadu_ps(&center[2 * i + 4]);
+        __m128 x  = _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y  = _mm_shuffle_ps(c0, c1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 sx = _mm_loadu_ps(&speed_x[i]);
+        __m128 sy = _mm_loadu_ps(&speed_y[i]);
+        __m128 gx = _mm_loadu_ps(&g_x[i]);
+        __m128 gy = _mm_loadu_ps(&g_y[i]);
+
+        x = _mm_add_ps(x, _mm_and_ps(alive, _mm_mul_ps(sx, move)));
+        y = _mm_add_ps(y, _mm_and_ps(alive, _mm_mul_ps(sy, move)));
+        sx = _mm_add_ps(sx, _mm_and_ps(alive, _mm_mul_ps(gx, accel)));
+        sy = _mm_add_ps(sy, _mm_and_ps(alive, _mm_mul_ps(gy, accel)));
+
+        __m128 new_life = _mm_sub_ps(old_life,
+            _mm_and_ps(alive, _mm_mul_ps(_mm_loadu_ps(&fade[i]), fade_speed)));
+
+        /* Dead lanes may divide by zero, but their result is discarded */
+        __m128 a = _mm_loadu_ps(&alpha[i]);
+        a = select(alive, _mm_mul_ps(a, _mm_div_ps(new_life, old_life)), a);
+
+        __m128 r = _mm_mul_ps(_mm_loadu_ps(&base_radius[i]),
+            _mm_sqrt_ps(_mm_max_ps(new_life, zero)));
+        r  = select(alive, r, _mm_loadu_ps(&radius[i]));
+        gx = select(alive,
+            select(_mm_cmplt_ps(_mm_loadu_ps(&start_x[i]), x), minus_one, one),
+            gx);
+
+        __m128 just_died = _mm_and_ps(alive, _mm_cmple_ps(new_life, zero));
+        int died_mask    = _mm_movemask_ps(just_died);
+        if (died_mask)
+        {
+            x = select(just_died, outside, x);
+            y = select(just_died, outside, y);
+            r = select(just_died, zero, r);
+            died += __builtin_popcount(died_mask);
+        }
+
+        _mm_storeu_ps(&center[2 * i], _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(&center[2 * i + 4], _mm_unpackhi_ps(x, y));
+        _mm_storeu_ps(&speed_x[i], sx);
+        _mm_storeu_ps(&speed_y[i], sy);
+        _mm_storeu_ps(&g_x[i], gx);
+        _mm_storeu_ps(&life[i], new_life);
+        _mm_storeu_ps(&alpha[i], a);
+        _mm_storeu_ps(&radius[i], r);
     }
 
-    for (auto& w : workers)
+#endif
+
+    for (; i < end; i++)
     {
-        w.join();
+        died += update_particle(i);
     }
+
+    return died;
 }
 
 void ParticleSystem::update()
@@ -164,10 +250,13 @@ void ParticleSystem::update()
     float time = (wf::get_current_time() - last_update_msec) / 16.0;
     last_update_msec = wf::get_current_time();
 
-    exec_worker_threads([=] (int start, int end)
+    /* Do not stall the compositor for more than a frame if there are too many
+     * particles, the remaining ones will simply be updated in the next frame */
+    wf::worker_pool_t::get().parallel_for(size(), particles_per_chunk,
+        [=] (size_t start, size_t end)
     {
-        update_worker(time, start, end);
-    });
+        particles_alive -= update_worker(time, start, end);
+    }, last_update_msec + 16);
 }
 
 int ParticleSystem::statistic()
@@ -181,6 +270,15 @@ void ParticleSystem::create_program()
     OpenGL::render_begin();
     program.set_simple(OpenGL::compile_program(particle_vert_source,
         particle_frag_source));
+
+    position_attrib     = program.get_attrib("position");
+    radius_attrib       = program.get_attrib("radius");
+    center_attrib       = program.get_attrib("center");
+    color_attrib        = program.get_attrib("color");
+    alpha_attrib        = program.get_attrib("alpha");
+    matrix_uniform      = program.get_uniform("matrix");
+    smoothing_uniform   = program.get_uniform("smoothing");
+    color_scale_uniform = program.get_uniform("color_scale");
     OpenGL::render_end();
 }
 
@@ -194,34 +292,38 @@ void ParticleSystem::render(glm::mat4 matrix)
         -1, 1
     };
 
-    program.attrib_pointer("position", 2, 0, vertex_data);
-    program.attrib_divisor("position", 0);
+    program.attrib_pointer(position_attrib, 2, 0, vertex_data);
+    program.attrib_divisor(position_attrib, 0);
 
-    program.attrib_pointer("radius", 1, 0, radius.data());
-    program.attrib_divisor("radius", 1);
+    program.attrib_pointer(radius_attrib, 1, 0, radius.data());
+    program.attrib_divisor(radius_attrib, 1);
 
-    program.attrib_pointer("center", 2, 0, center.data());
-    program.attrib_divisor("center", 1);
+    program.attrib_pointer(center_attrib, 2, 0, center.data());
+    program.attrib_divisor(center_attrib, 1);
+
+    program.attrib_pointer(color_attrib, 3, 0, color.data());
+    program.attrib_divisor(color_attrib, 1);
+
+    program.attrib_pointer(alpha_attrib, 1, 0, alpha.data());
+    program.attrib_divisor(alpha_attrib, 1);
 
     // matrix
-    program.uniformMatrix4f("matrix", matrix);
+    program.uniformMatrix4f(matrix_uniform, matrix);
 
     /* Darken the background */
-    program.attrib_pointer("color", 4, 0, dark_color.data());
-    program.attrib_divisor("color", 1);
-
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA));
-    program.uniform1f("smoothing", 0.7);
+    program.uniform1f(smoothing_uniform, 0.7);
+    program.uniform1f(color_scale_uniform, 0.5);
 
     // TODO: optimize shaders for this case
-    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, size()));
 
     // particle color
-    program.attrib_pointer("color", 4, 0, color.data());
     GL_CALL(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
-    program.uniform1f("smoothing", 0.5);
-    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, ps.size()));
+    program.uniform1f(smoothing_uniform, 0.5);
+    program.uniform1f(color_scale_uniform, 1.0);
+    GL_CALL(glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, size()));
 
     GL_CALL(glDisable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
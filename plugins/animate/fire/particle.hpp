@@ -6,6 +6,8 @@
 #include <atomic>
 #include <vector>
 
+/* The initial state of a particle, filled by the ParticleIniter.
+ * The particle system itself stores particles as structure of arrays. */
 struct Particle
 {
     float life = -1;
@@ -17,14 +19,10 @@ struct Particle
     glm::vec2 start_pos;
 
     glm::vec4 color{1.0, 1.0, 1.0, 1.0};
-
-    /* update the given particle
-     * time is the percentage of the frame which has elapsed
-     * must be thread-safe */
-    void update(float time);
 };
 
-/* a function to initialize a particle */
+/* a function to initialize a particle
+ * must be thread-safe */
 using ParticleIniter = std::function<void (Particle&)>;
 
 class ParticleSystem
@@ -70,20 +68,37 @@ class ParticleSystem
     uint32_t last_update_msec;
 
     std::atomic<int> particles_alive;
-    std::vector<Particle> ps;
-
-    static constexpr int color_per_particle = 4;
-    std::vector<float> color, dark_color;
 
-    static constexpr int radius_per_particle = 1;
-    std::vector<float> radius;
+    /* The state of the particles, stored as structure of arrays so that they
+     * can be updated with SIMD instructions.
+     * The arrays marked as GPU are directly used as vertex attributes. */
+    std::vector<float> life, fade, base_radius;
+    std::vector<float> speed_x, speed_y, g_x, g_y, start_x;
 
     static constexpr int center_per_particle = 2;
-    std::vector<float> center;
+    std::vector<float> center; // GPU: interleaved x and y position
+    std::vector<float> radius; // GPU
+
+    static constexpr int color_per_particle = 3;
+    std::vector<float> color; // GPU: rgb, constant after spawning
+    std::vector<float> alpha; // GPU
+
+    /* Particles are processed on the worker pool in chunks of this size */
+    static constexpr int particles_per_chunk = 256;
 
     OpenGL::program_t program;
-    void exec_worker_threads(std::function<void(int, int)> spawn_worker);
-    void update_worker(float time, int start, int end);
+    OpenGL::attrib_handle_t position_attrib, radius_attrib, center_attrib,
+        color_attrib, alpha_attrib;
+    OpenGL::uniform_handle_t matrix_uniform, smoothing_uniform,
+        color_scale_uniform;
+
+    /* Update the particles in the range [start, end).
+     * Returns the number of particles which died. */
+    int update_worker(float time, size_t start, size_t end);
+    /* Scalar version of update_worker() for a single particle */
+    int update_particle(size_t i);
+    /* Copy the initial state of a particle to the given index */
+    void store_particle(size_t i, const Particle& p);
     void create_program();
 };
 
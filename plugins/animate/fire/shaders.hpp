@@ -8,9 +8,11 @@ static const char *particle_vert_source =
 attribute mediump float radius;
 attribute mediump vec2 position;
 attribute mediump vec2 center;
-attribute mediump vec4 color;
+attribute mediump vec3 color;
+attribute mediump float alpha;
 
 uniform mat4 matrix;
+uniform mediump float color_scale;
 
 varying mediump vec2 uv;
 varying mediump vec4 out_color;
@@ -21,7 +23,7 @@ void main() {
     gl_Position = matrix * vec4(center.x + uv.x * 0.75, center.y + uv.y, 0.0, 1.0);
 
     R = radius;
-    out_color = color;
+    out_color = vec4(color, alpha) * color_scale;
 }
 )";
 
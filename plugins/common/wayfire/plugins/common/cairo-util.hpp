@@ -1,7 +1,15 @@
 #pragma once
 
 #include <string>
+#include <sstream>
+#include <list>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 #include <wayfire/plugins/common/simple-texture.hpp>
+#include <wayfire/plugins/common/shared-core-data.hpp>
+#include <wayfire/worker-pool.hpp>
 #include <wayfire/config/types.hpp>
 #include <cairo.h>
 #include <pango/pango.h>
@@ -106,104 +114,75 @@ struct cairo_text_t
             cairo_create_surface();
         }
 
-        PangoFontDescription *font_desc;
-        PangoLayout *layout;
-        PangoRectangle extents;
-        /* TODO: font properties could be made parameters! */
-        font_desc = pango_font_description_from_string("sans-serif bold");
-        pango_font_description_set_absolute_size(font_desc,
-            par.font_size * par.output_scale * PANGO_SCALE);
-        layout = pango_cairo_create_layout(cr);
-        pango_layout_set_font_description(layout, font_desc);
-        pango_layout_set_text(layout, text.c_str(), text.size());
-        pango_layout_get_extents(layout, NULL, &extents);
-
-        double xpad = par.bg_rect ? 10.0 * par.output_scale : 0.0;
-        double ypad = par.bg_rect ?
-            0.2 * ((float)extents.height / PANGO_SCALE) : 0.0;
-        int w = (int)((float)extents.width / PANGO_SCALE + 2 * xpad);
-        int h = (int)((float)extents.height / PANGO_SCALE + 2 * ypad);
-        wf::dimensions_t ret = {w, h};
-        if (par.max_size.width && (w > par.max_size.width * par.output_scale))
-        {
-            w = (int)std::floor(par.max_size.width * par.output_scale);
-        }
-
-        if (par.max_size.height && (h > par.max_size.height * par.output_scale))
-        {
-            h = (int)std::floor(par.max_size.height * par.output_scale);
-        }
-
-        if ((w != surface_size.width) || (h != surface_size.height))
+        auto tl = create_layout(cr, text, par);
+        if ((tl.size.width != surface_size.width) ||
+            (tl.size.height != surface_size.height))
         {
-            if (par.exact_size || (w > surface_size.width) ||
-                (h > surface_size.height))
+            if (par.exact_size || (tl.size.width > surface_size.width) ||
+                (tl.size.height > surface_size.height))
             {
-                surface_size.width  = w;
-                surface_size.height = h;
+                surface_size = tl.size;
                 cairo_create_surface();
             }
         }
 
-        cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
-        cairo_paint(cr);
-
-        int x = (surface_size.width - w) / 2;
-        int y = (surface_size.height - h) / 2;
-
-        if (par.bg_rect)
-        {
-            int min_r = (int)(20 * par.output_scale);
-            int r     = par.rounded_rect ? (h > min_r ? min_r : (h - 2) / 2) : 0;
-
-            cairo_move_to(cr, x + r, y);
-            cairo_line_to(cr, x + w - r, y);
-            if (par.rounded_rect)
-            {
-                cairo_curve_to(cr, x + w, y, x + w, y, x + w, y + r);
-            }
-
-            cairo_line_to(cr, x + w, y + h - r);
-            if (par.rounded_rect)
-            {
-                cairo_curve_to(cr, x + w, y + h, x + w, y + h, x + w - r, y + h);
-            }
-
-            cairo_line_to(cr, x + r, y + h);
-            if (par.rounded_rect)
-            {
-                cairo_curve_to(cr, x, y + h, x, y + h, x, y + h - r);
-            }
-
-            cairo_line_to(cr, x, y + r);
-            if (par.rounded_rect)
-            {
-                cairo_curve_to(cr, x, y, x, y, x + r, y);
-            }
-
-            cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
-            cairo_set_source_rgba(cr, par.bg_color.r, par.bg_color.g,
-                par.bg_color.b, par.bg_color.a);
-            cairo_fill(cr);
-        }
-
-        x += xpad;
-        y += ypad;
-
-        cairo_move_to(cr, x - (float)extents.x / PANGO_SCALE, y);
-        cairo_set_source_rgba(cr, par.text_color.r, par.text_color.g,
-            par.text_color.b, par.text_color.a);
-
-        pango_cairo_show_layout(cr, layout);
-        pango_font_description_free(font_desc);
-        g_object_unref(layout);
+        paint_layout(cr, surface_size, tl, par);
+        g_object_unref(tl.layout);
 
         cairo_surface_flush(surface);
         OpenGL::render_begin();
         cairo_surface_upload_to_texture(surface, tex);
         OpenGL::render_end();
 
-        return ret;
+        return tl.needed;
+    }
+
+    /**
+     * Render the given text on a new cairo surface, as render_text() does with
+     * par.exact_size set. It doesn't use OpenGL, so it can be called from any
+     * thread. The caller is responsible for freeing the surface afterwards.
+     *
+     * @param text      text to render
+     * @param par       parameters for rendering
+     * @param text_size set to the size needed to render the text, as returned by
+     *   render_text()
+     */
+    static cairo_surface_t *rasterize(const std::string& text, const params& par,
+        wf::dimensions_t& text_size)
+    {
+        auto dummy_surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+        auto dummy_cr = cairo_create(dummy_surface);
+        auto tl = create_layout(dummy_cr, text, par);
+        cairo_destroy(dummy_cr);
+        cairo_surface_destroy(dummy_surface);
+
+        auto surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+            tl.size.width, tl.size.height);
+        auto cr = cairo_create(surface);
+        paint_layout(cr, tl.size, tl, par);
+        cairo_destroy(cr);
+        g_object_unref(tl.layout);
+
+        cairo_surface_flush(surface);
+        text_size = tl.needed;
+        return surface;
+    }
+
+    /**
+     * Get a key which identifies the result of rendering the given text with
+     * the given parameters, for use with wf::cached_text_t.
+     */
+    static std::string cache_key(const std::string& text, const params& par)
+    {
+        std::ostringstream key;
+        key << "cairo-text " << par.font_size << " " << par.output_scale << " " <<
+            par.max_size.width << "x" << par.max_size.height << " " <<
+            par.bg_color.r << "," << par.bg_color.g << "," << par.bg_color.b <<
+            "," << par.bg_color.a << " " << par.text_color.r << "," <<
+            par.text_color.g << "," << par.text_color.b << "," <<
+            par.text_color.a << " " << par.bg_rect << par.rounded_rect <<
+            par.exact_size << "\n" << text;
+        return key.str();
     }
 
     /**
@@ -294,6 +273,111 @@ struct cairo_text_t
     }
 
   protected:
+    /* The text laid out for rendering, with the size of its surface */
+    struct text_layout_t
+    {
+        PangoLayout *layout;
+        PangoRectangle extents;
+        double xpad, ypad;
+        /* size needed to render the text */
+        wf::dimensions_t needed;
+        /* size after cropping to par.max_size */
+        wf::dimensions_t size;
+    };
+
+    static text_layout_t create_layout(cairo_t *cr, const std::string& text,
+        const params& par)
+    {
+        text_layout_t tl;
+        /* TODO: font properties could be made parameters! */
+        auto font_desc = pango_font_description_from_string("sans-serif bold");
+        pango_font_description_set_absolute_size(font_desc,
+            par.font_size * par.output_scale * PANGO_SCALE);
+        tl.layout = pango_cairo_create_layout(cr);
+        pango_layout_set_font_description(tl.layout, font_desc);
+        pango_layout_set_text(tl.layout, text.c_str(), text.size());
+        pango_layout_get_extents(tl.layout, NULL, &tl.extents);
+        pango_font_description_free(font_desc);
+
+        tl.xpad = par.bg_rect ? 10.0 * par.output_scale : 0.0;
+        tl.ypad = par.bg_rect ?
+            0.2 * ((float)tl.extents.height / PANGO_SCALE) : 0.0;
+        int w = (int)((float)tl.extents.width / PANGO_SCALE + 2 * tl.xpad);
+        int h = (int)((float)tl.extents.height / PANGO_SCALE + 2 * tl.ypad);
+        tl.needed = {w, h};
+        if (par.max_size.width && (w > par.max_size.width * par.output_scale))
+        {
+            w = (int)std::floor(par.max_size.width * par.output_scale);
+        }
+
+        if (par.max_size.height && (h > par.max_size.height * par.output_scale))
+        {
+            h = (int)std::floor(par.max_size.height * par.output_scale);
+        }
+
+        tl.size = {w, h};
+        return tl;
+    }
+
+    /* Paint the text centered on a surface of the given size */
+    static void paint_layout(cairo_t *cr, wf::dimensions_t surface_size,
+        const text_layout_t& tl, const params& par)
+    {
+        int w = tl.size.width;
+        int h = tl.size.height;
+
+        cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+        cairo_paint(cr);
+
+        int x = (surface_size.width - w) / 2;
+        int y = (surface_size.height - h) / 2;
+
+        if (par.bg_rect)
+        {
+            int min_r = (int)(20 * par.output_scale);
+            int r     = par.rounded_rect ? (h > min_r ? min_r : (h - 2) / 2) : 0;
+
+            cairo_move_to(cr, x + r, y);
+            cairo_line_to(cr, x + w - r, y);
+            if (par.rounded_rect)
+            {
+                cairo_curve_to(cr, x + w, y, x + w, y, x + w, y + r);
+            }
+
+            cairo_line_to(cr, x + w, y + h - r);
+            if (par.rounded_rect)
+            {
+                cairo_curve_to(cr, x + w, y + h, x + w, y + h, x + w - r, y + h);
+            }
+
+            cairo_line_to(cr, x + r, y + h);
+            if (par.rounded_rect)
+            {
+                cairo_curve_to(cr, x, y + h, x, y + h, x, y + h - r);
+            }
+
+            cairo_line_to(cr, x, y + r);
+            if (par.rounded_rect)
+            {
+                cairo_curve_to(cr, x, y, x, y, x + r, y);
+            }
+
+            cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+            cairo_set_source_rgba(cr, par.bg_color.r, par.bg_color.g,
+                par.bg_color.b, par.bg_color.a);
+            cairo_fill(cr);
+        }
+
+        x += tl.xpad;
+        y += tl.ypad;
+
+        cairo_move_to(cr, x - (float)tl.extents.x / PANGO_SCALE, y);
+        cairo_set_source_rgba(cr, par.text_color.r, par.text_color.g,
+            par.text_color.b, par.text_color.a);
+
+        pango_cairo_show_layout(cr, tl.layout);
+    }
+
     /* cairo context and surface for the text */
     cairo_t *cr = nullptr;
     cairo_surface_t *surface = nullptr;
@@ -325,4 +409,260 @@ struct cairo_text_t
         cr = cairo_create(surface);
     }
 };
+
+/** A texture with rendered text, shared between the users of wf::cached_text_t. */
+struct text_texture_t
+{
+    wf::simple_texture_t tex;
+    /** The size needed to render the text, see cairo_text_t::render_text() */
+    wf::dimensions_t text_size;
+};
+
+/**
+ * Renders text on a new cairo surface, and sets text_size to the size needed
+ * to render the text. It runs on a worker thread, so it must not use OpenGL or
+ * other compositor state.
+ */
+using text_rasterizer_t =
+    std::function<cairo_surface_t*(wf::dimensions_t& text_size)>;
+
+/**
+ * The compositor-wide cache of text textures. Plugins use it through
+ * wf::cached_text_t.
+ *
+ * Textures are looked up by a key which identifies the text and everything
+ * which affects its rendering. Missing textures are rasterized on the worker
+ * pool and uploaded on the compositor thread. Identical requests which arrive
+ * while a texture is being rasterized wait for the same job.
+ */
+class text_texture_cache_t
+{
+  public:
+    using ready_callback_t = std::function<void (std::shared_ptr<text_texture_t>)>;
+
+    /** The number of textures kept after they were last requested */
+    static constexpr size_t MAX_ENTRIES = 64;
+
+    /**
+     * Get the texture for the given key.
+     *
+     * @param owner The owner of the job which rasterizes the text, if one is
+     *   started, see wf::worker_pool_t::drain().
+     * @return The texture if it is cached. Otherwise, the text is rasterized
+     *   asynchronously, nullptr is returned, and on_ready is called with the
+     *   texture once it is ready, unless it has been destroyed by then.
+     */
+    std::shared_ptr<text_texture_t> request(const std::string& key,
+        text_rasterizer_t rasterizer, std::weak_ptr<ready_callback_t> on_ready,
+        const void *owner)
+    {
+        return state->request(key, std::move(rasterizer), std::move(on_ready),
+            owner);
+    }
+
+  private:
+    struct state_t : public std::enable_shared_from_this<state_t>
+    {
+        struct entry_t
+        {
+            std::shared_ptr<text_texture_t> texture;
+            std::list<std::string>::iterator lru_pos;
+        };
+
+        std::unordered_map<std::string, entry_t> entries;
+        /* Keys of the entries, most recently requested first */
+        std::list<std::string> lru;
+        /* Callbacks waiting for the textures which are being rasterized */
+        std::unordered_map<std::string,
+            std::vector<std::weak_ptr<ready_callback_t>>> pending;
+
+        std::shared_ptr<text_texture_t> request(const std::string& key,
+            text_rasterizer_t rasterizer, std::weak_ptr<ready_callback_t> on_ready,
+            const void *owner)
+        {
+            auto it = entries.find(key);
+            if (it != entries.end())
+            {
+                lru.splice(lru.begin(), lru, it->second.lru_pos);
+                return it->second.texture;
+            }
+
+            auto& waiting = pending[key];
+            waiting.push_back(std::move(on_ready));
+            if (waiting.size() > 1)
+            {
+                return nullptr;
+            }
+
+            struct result_t
+            {
+                cairo_surface_t *surface = nullptr;
+                wf::dimensions_t text_size;
+            };
+
+            auto result = std::make_shared<result_t>();
+            std::weak_ptr<state_t> self = shared_from_this();
+            wf::worker_pool_t::get().submit([result, rasterizer] ()
+            {
+                result->surface = rasterizer(result->text_size);
+            }, [self, key, result] ()
+            {
+                if (auto state = self.lock())
+                {
+                    state->finish(key, result->surface, result->text_size);
+                }
+
+                cairo_surface_destroy(result->surface);
+            }, owner);
+
+            return nullptr;
+        }
+
+        void finish(const std::string& key, cairo_surface_t *surface,
+            wf::dimensions_t text_size)
+        {
+            auto waiting = std::move(pending[key]);
+            pending.erase(key);
+
+            std::vector<std::shared_ptr<ready_callback_t>> callbacks;
+            for (auto& weak_cb : waiting)
+            {
+                if (auto cb = weak_cb.lock())
+                {
+                    callbacks.push_back(cb);
+                }
+            }
+
+            /* Nobody shows this text anymore, for ex. the title changed again */
+            if (callbacks.empty())
+            {
+                return;
+            }
+
+            auto texture = std::make_shared<text_texture_t>();
+            texture->text_size = text_size;
+            OpenGL::render_begin();
+            cairo_surface_upload_to_texture(surface, texture->tex);
+            OpenGL::render_end();
+
+            lru.push_front(key);
+            entries[key] = {texture, lru.begin()};
+            while (lru.size() > MAX_ENTRIES)
+            {
+                entries.erase(lru.back());
+                lru.pop_back();
+            }
+
+            for (auto& cb : callbacks)
+            {
+                (*cb)(texture);
+            }
+        }
+    };
+
+    std::shared_ptr<state_t> state = std::make_shared<state_t>();
+};
+
+/**
+ * Text rendered to a texture through the compositor-wide text cache, so that
+ * views and plugins which show the same text share one texture, and text is
+ * rasterized off the compositor thread.
+ *
+ * After the text changes, the previous texture is kept until the new one is
+ * ready, so frequent title changes do not cause flicker or stalls.
+ */
+class cached_text_t
+{
+  public:
+    /**
+     * @param on_ready Called when a texture which was rasterized asynchronously
+     *   becomes current, for ex. to damage the area where the text is shown.
+     */
+    cached_text_t(std::function<void()> on_ready = nullptr) :
+        on_ready(std::move(on_ready))
+    {}
+
+    cached_text_t(const cached_text_t &) = delete;
+    cached_text_t& operator =(const cached_text_t&) = delete;
+
+    /**
+     * The jobs started by this object run code of the plugin which created
+     * it, wait for them so that none of them runs after the plugin is
+     * unloaded.
+     */
+    ~cached_text_t()
+    {
+        /* The completion of the jobs must not update this object anymore */
+        callback.reset();
+        if (requested_async)
+        {
+            wf::worker_pool_t::get().drain(this);
+        }
+    }
+
+    /**
+     * Request the text identified by key, rendered by rasterizer if it isn't
+     * cached yet.
+     *
+     * @return true if the key changed.
+     */
+    bool set(const std::string& key, text_rasterizer_t rasterizer)
+    {
+        if (key == current_key)
+        {
+            return false;
+        }
+
+        current_key = key;
+        /* Replacing the callback drops the requests for previous keys */
+        callback = std::make_shared<text_texture_cache_t::ready_callback_t>(
+            [=] (std::shared_ptr<text_texture_t> texture)
+        {
+            this->texture = texture;
+            if (this->on_ready)
+            {
+                this->on_ready();
+            }
+        });
+
+        if (auto cached =
+                cache->request(key, std::move(rasterizer), callback, this))
+        {
+            texture = cached;
+        } else
+        {
+            requested_async = true;
+        }
+
+        return true;
+    }
+
+    /** Request the given text rendered as by wf::cairo_text_t. */
+    bool set(const std::string& text, const cairo_text_t::params& par)
+    {
+        return set(cairo_text_t::cache_key(text, par),
+            [=] (wf::dimensions_t& text_size)
+        {
+            return cairo_text_t::rasterize(text, par, text_size);
+        });
+    }
+
+    /**
+     * @return The current texture, or nullptr if no text has been rendered
+     *   yet.
+     */
+    const text_texture_t *get() const
+    {
+        return texture.get();
+    }
+
+  private:
+    wf::shared_data::ref_ptr_t<text_texture_cache_t> cache;
+    std::shared_ptr<text_texture_t> texture;
+    std::shared_ptr<text_texture_cache_t::ready_callback_t> callback;
+    std::string current_key;
+    std::function<void()> on_ready;
+    /* Whether a job may have been started, see ~cached_text_t() */
+    bool requested_async = false;
+};
 }
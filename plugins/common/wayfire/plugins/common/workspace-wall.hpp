@@ -2,6 +2,8 @@
 
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
 #include "workspace-stream-sharing.hpp"
 
 namespace wf
@@ -105,7 +107,7 @@ class workspace_wall_t : public wf::signal_provider_t
      */
     void render_wall(const wf::framebuffer_t& fb, wf::geometry_t geometry)
     {
-        update_streams();
+        update_streams(get_stream_scale(fb, geometry));
 
         OpenGL::render_begin(fb);
         fb.logic_scissor(geometry);
@@ -218,13 +220,41 @@ class workspace_wall_t : public wf::signal_provider_t
 
     std::vector<std::vector<glm::vec4>> render_colors;
 
+    /**
+     * The scale of the workspace streams is rounded up to a multiple of
+     * 1 / stream_scale_steps, so that the streams are not repainted whenever
+     * the scale changes a little, for ex. during a zoom animation.
+     */
+    static constexpr int stream_scale_steps = 8;
+
     /** Update or start visible streams */
-    void update_streams()
+    void update_streams(float scale)
     {
         for (auto& ws : get_visible_workspaces(viewport))
         {
-            streams->update(ws);
+            streams->update(ws, scale);
+        }
+    }
+
+    /**
+     * Calculate the scale at which the workspaces are displayed when the
+     * viewport is rendered to the given box of the framebuffer, so that the
+     * workspace streams do not have a higher resolution than needed.
+     */
+    float get_stream_scale(const wf::framebuffer_t& fb,
+        const wf::geometry_t& target) const
+    {
+        if ((viewport.width <= 0) || (viewport.height <= 0))
+        {
+            return 1.0;
         }
+
+        auto output_fb = output->render->get_target_framebuffer();
+        double scale   = std::max(target.width * 1.0 / viewport.width,
+            target.height * 1.0 / viewport.height) * fb.scale / output_fb.scale;
+
+        scale = std::ceil(scale * stream_scale_steps) / stream_scale_steps;
+        return std::min(scale, 1.0);
     }
 
     /**
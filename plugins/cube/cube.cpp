@@ -78,7 +78,7 @@ class wayfire_cube : public wf::plugin_interface_t
             background = std::make_unique<wf_cube_background_skydome>(output);
         } else if (last_background_mode == "cubemap")
         {
-            background = std::make_unique<wf_cube_background_cubemap>();
+            background = std::make_unique<wf_cube_background_cubemap>(output);
         } else
         {
             LOGE("cube: Unrecognized background mode %s. Using default \"simple\"",
@@ -4,11 +4,14 @@
 #include <config.h>
 #include <wayfire/core.hpp>
 #include <wayfire/img.hpp>
+#include <wayfire/output.hpp>
+#include <wayfire/render-manager.hpp>
 
 #include "cubemap-shaders.tpp"
 
-wf_cube_background_cubemap::wf_cube_background_cubemap()
+wf_cube_background_cubemap::wf_cube_background_cubemap(wf::output_t *output)
 {
+    this->output = output;
     create_program();
     reload_texture();
 }
@@ -17,7 +20,6 @@ wf_cube_background_cubemap::~wf_cube_background_cubemap()
 {
     OpenGL::render_begin();
     program.free_resources();
-    GL_CALL(glDeleteTextures(1, &tex));
     GL_CALL(glDeleteBuffers(1, &vbo_cube_vertices));
     GL_CALL(glDeleteBuffers(1, &ibo_cube_indices));
     OpenGL::render_end();
@@ -28,53 +30,26 @@ void wf_cube_background_cubemap::create_program()
     OpenGL::render_begin();
     program.set_simple(
         OpenGL::compile_program(cubemap_vertex, cubemap_fragment));
+    GL_CALL(glGenBuffers(1, &vbo_cube_vertices));
+    GL_CALL(glGenBuffers(1, &ibo_cube_indices));
     OpenGL::render_end();
 }
 
 void wf_cube_background_cubemap::reload_texture()
 {
-    if (!last_background_image.compare(background_image))
+    /* The image is decoded in the background and uploaded over the next
+     * frames, the previous image is shown until then. */
+    texture.load(background_image, [=] ()
     {
-        return;
-    }
-
-    last_background_image = background_image;
+        output->render->schedule_redraw();
+    });
 
     OpenGL::render_begin();
-    if (tex == (uint32_t)-1)
-    {
-        GL_CALL(glGenTextures(1, &tex));
-        GL_CALL(glGenBuffers(1, &vbo_cube_vertices));
-        GL_CALL(glGenBuffers(1, &ibo_cube_indices));
-    }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
-    if (!image_io::load_from_file(last_background_image, GL_TEXTURE_CUBE_MAP))
-    {
-        LOGE("Failed to load cubemap background image from \"%s\".",
-            last_background_image.c_str());
-
-        GL_CALL(glDeleteTextures(1, &tex));
-        GL_CALL(glDeleteBuffers(1, &vbo_cube_vertices));
-        GL_CALL(glDeleteBuffers(1, &ibo_cube_indices));
-        tex = -1;
-    }
-
-    if (tex != (uint32_t)-1)
+    if (texture.update())
     {
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
-            GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER,
-            GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S,
-            GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T,
-            GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R,
-            GL_CLAMP_TO_EDGE));
+        output->render->schedule_redraw();
     }
 
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
     OpenGL::render_end();
 }
 
@@ -83,6 +58,7 @@ void wf_cube_background_cubemap::render_frame(const wf::framebuffer_t& fb,
 {
     reload_texture();
 
+    GLuint tex = texture.get_texture();
     OpenGL::render_begin(fb);
     if (tex == (uint32_t)-1)
     {
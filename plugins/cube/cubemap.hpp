@@ -2,26 +2,28 @@
 #define WF_CUBE_CUBEMAP_HPP
 
 #include "cube-background.hpp"
+#include <wayfire/img.hpp>
 
 class wf_cube_background_cubemap : public wf_cube_background_base
 {
   public:
-    wf_cube_background_cubemap();
+    wf_cube_background_cubemap(wf::output_t *output);
     virtual void render_frame(const wf::framebuffer_t& fb,
         wf_cube_animation_attribs& attribs) override;
 
     ~wf_cube_background_cubemap();
 
   private:
+    wf::output_t *output;
+
     void reload_texture();
     void create_program();
 
     OpenGL::program_t program;
-    GLuint tex = -1;
+    image_io::async_texture_t texture{GL_TEXTURE_CUBE_MAP};
     GLuint vbo_cube_vertices;
     GLuint ibo_cube_indices;
 
-    std::string last_background_image;
     wf::option_wrapper_t<std::string> background_image{"cube/cubemap_image"};
 };
 
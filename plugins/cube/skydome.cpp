@@ -3,6 +3,7 @@
 #include <wayfire/img.hpp>
 
 #include <wayfire/output.hpp>
+#include <wayfire/render-manager.hpp>
 #include <wayfire/workspace-manager.hpp>
 
 
@@ -35,37 +36,19 @@ void wf_cube_background_skydome::load_program()
 
 void wf_cube_background_skydome::reload_texture()
 {
-    if (!last_background_image.compare(background_image))
+    /* The image is decoded in the background and uploaded over the next
+     * frames, the previous image is shown until then. */
+    texture.load(background_image, [=] ()
     {
-        return;
-    }
+        output->render->schedule_redraw();
+    });
 
-    last_background_image = background_image;
     OpenGL::render_begin();
-
-    if (tex == (uint32_t)-1)
+    if (texture.update())
     {
-        GL_CALL(glGenTextures(1, &tex));
+        output->render->schedule_redraw();
     }
 
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-
-    if (image_io::load_from_file(last_background_image, GL_TEXTURE_2D))
-    {
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    } else
-    {
-        LOGE("Failed to load skydome image from \"%s\".",
-            last_background_image.c_str());
-        GL_CALL(glDeleteTextures(1, &tex));
-        tex = -1;
-    }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
-
     OpenGL::render_end();
 }
 
@@ -130,6 +113,7 @@ void wf_cube_background_skydome::render_frame(const wf::framebuffer_t& fb,
     fill_vertices();
     reload_texture();
 
+    GLuint tex = texture.get_texture();
     if (tex == (uint32_t)-1)
     {
         GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
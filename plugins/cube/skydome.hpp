@@ -3,6 +3,7 @@
 
 #include "cube-background.hpp"
 #include "wayfire/output.hpp"
+#include <wayfire/img.hpp>
 #include <vector>
 
 class wf_cube_background_skydome : public wf_cube_background_base
@@ -22,13 +23,12 @@ class wf_cube_background_skydome : public wf_cube_background_base
     void reload_texture();
 
     OpenGL::program_t program;
-    GLuint tex = -1;
+    image_io::async_texture_t texture{GL_TEXTURE_2D};
 
     std::vector<GLfloat> vertices;
     std::vector<GLfloat> coords;
     std::vector<GLuint> indices;
 
-    std::string last_background_image;
     int last_mirror = -1;
     wf::option_wrapper_t<std::string> background_image{"cube/skydome_texture"};
     wf::option_wrapper_t<bool> mirror_opt{"cube/skydome_mirror"};
@@ -18,6 +18,7 @@
 #include <wayfire/plugins/common/cairo-util.hpp>
 
 #include <cairo.h>
+#include <sstream>
 
 class simple_decoration_surface : public wf::surface_interface_t,
     public wf::compositor_surface_t
@@ -38,23 +39,23 @@ class simple_decoration_surface : public wf::surface_interface_t,
         int target_width  = width * scale;
         int target_height = height * scale;
 
-        if ((title_texture.tex.width != target_width) ||
-            (title_texture.tex.height != target_height) ||
-            (title_texture.current_text != view->get_title()))
+        auto font  = theme.get_font();
+        auto title = view->get_title();
+        std::ostringstream key;
+        key << "decoration " << font << " " << target_width << "x" <<
+            target_height << "\n" << title;
+
+        title_texture.set(key.str(), [=] (wf::dimensions_t& text_size)
         {
-            auto surface = theme.render_text(view->get_title(),
+            text_size = {target_width, target_height};
+            return wf::decor::decoration_theme_t::render_text(font, title,
                 target_width, target_height);
-            cairo_surface_upload_to_texture(surface, title_texture.tex);
-            cairo_surface_destroy(surface);
-            title_texture.current_text = view->get_title();
-        }
+        });
     }
 
-    struct
-    {
-        wf::simple_texture_t tex;
-        std::string current_text = "";
-    } title_texture;
+    /* The title is shown with the previous texture until the new one has been
+     * rendered, then the view is damaged to show the new one. */
+    wf::cached_text_t title_texture{[=] () { view->damage(); }};
 
     wf::decor::decoration_theme_t theme;
     wf::decor::decoration_layout_t layout;
@@ -97,8 +98,11 @@ class simple_decoration_surface : public wf::surface_interface_t,
         wf::geometry_t geometry)
     {
         update_title(geometry.width, geometry.height, fb.scale);
-        OpenGL::render_texture(title_texture.tex.tex, fb, geometry,
-            glm::vec4(1.0f), OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
+        if (auto texture = title_texture.get())
+        {
+            OpenGL::render_texture(texture->tex.tex, fb, geometry,
+                glm::vec4(1.0f), OpenGL::TEXTURE_TRANSFORM_INVERT_Y);
+        }
     }
 
     void render_scissor_box(const wf::framebuffer_t& fb, wf::point_t origin,
@@ -48,6 +48,22 @@ void decoration_theme_t::render_background(const wf::framebuffer_t& fb,
  */
 cairo_surface_t*decoration_theme_t::render_text(std::string text,
     int width, int height) const
+{
+    return render_text(get_font(), text, width, height);
+}
+
+/** @return The font used for the title */
+std::string decoration_theme_t::get_font() const
+{
+    return font;
+}
+
+/**
+ * Render the given text with the given font on a cairo_surface_t with the
+ * given size. Safe to call from any thread.
+ */
+cairo_surface_t*decoration_theme_t::render_text(const std::string& font,
+    const std::string& text, int width, int height)
 {
     const auto format = CAIRO_FORMAT_ARGB32;
     auto surface = cairo_image_surface_create(format, width, height);
@@ -66,7 +82,7 @@ cairo_surface_t*decoration_theme_t::render_text(std::string text,
     PangoLayout *layout;
 
     // render text
-    font_desc = pango_font_description_from_string(((std::string)font).c_str());
+    font_desc = pango_font_description_from_string(font.c_str());
     pango_font_description_set_absolute_size(font_desc, font_size * PANGO_SCALE);
 
     layout = pango_cairo_create_layout(cr);
@@ -38,6 +38,18 @@ class decoration_theme_t
      */
     cairo_surface_t *render_text(std::string text, int width, int height) const;
 
+    /**
+     * Render the given text with the given font on a cairo_surface_t with the
+     * given size. It doesn't use the theme's options, so it can be called from
+     * any thread.
+     * The caller is responsible for freeing the memory afterwards.
+     */
+    static cairo_surface_t *render_text(const std::string& font,
+        const std::string& text, int width, int height);
+
+    /** @return The font used for the title */
+    std::string get_font() const;
+
     struct button_state_t
     {
         /** Button width */
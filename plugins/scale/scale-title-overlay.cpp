@@ -24,30 +24,39 @@ static wayfire_view find_toplevel_parent(wayfire_view view)
 struct view_title_texture_t : public wf::custom_data_t
 {
     wayfire_view view;
-    wf::cairo_text_t overlay;
+    /* Rendered asynchronously through the shared text cache: the previous
+     * texture is shown until the new one is ready, then the view is damaged. */
+    wf::cached_text_t overlay{[=] () { view->damage(); }};
     wf::cairo_text_t::params par;
-    bool overflow = false;
     wayfire_view dialog; /* the texture should be rendered on top of this dialog */
 
     /**
      * Render the overlay text in our texture, cropping it to the size by
      * the given box.
+     *
+     * @return true if a new texture was requested.
      */
-    void update_overlay_texture(wf::dimensions_t dim)
+    bool update_overlay_texture(wf::dimensions_t dim)
     {
         par.max_size = dim;
-        update_overlay_texture();
+        return update_overlay_texture();
     }
 
-    void update_overlay_texture()
+    bool update_overlay_texture()
     {
-        auto res = overlay.render_text(view->get_title(), par);
-        overflow = res.width > overlay.tex.width;
+        return overlay.set(view->get_title(), par);
+    }
+
+    /** Whether the current texture was cropped to fit the view. */
+    bool overflow() const
+    {
+        auto texture = overlay.get();
+        return texture && (texture->text_size.width > texture->tex.width);
     }
 
     wf::signal_connection_t view_changed = [this] (auto)
     {
-        if (overlay.tex.tex != (GLuint) - 1)
+        if (overlay.get())
         {
             update_overlay_texture();
         }
@@ -269,19 +278,20 @@ class view_title_overlay_t : public wf::scale_transformer_t::overlay_t
          * TODO: check if this wastes too high CPU power when views are being
          * animated and maybe redraw less frequently
          */
-        if ((tex.overlay.tex.tex == (GLuint) - 1) ||
+        auto texture = tex.overlay.get();
+        if (!texture ||
             (output_scale != tex.par.output_scale) ||
-            (tex.overlay.tex.width > box.width * output_scale) ||
-            (tex.overflow &&
-             (tex.overlay.tex.width < std::floor(box.width * output_scale))))
+            (texture->tex.width > box.width * output_scale) ||
+            (tex.overflow() &&
+             (texture->tex.width < std::floor(box.width * output_scale))))
         {
             tex.par.output_scale = output_scale;
-            tex.update_overlay_texture({box.width, box.height});
-            ret = true;
+            ret |= tex.update_overlay_texture({box.width, box.height});
+            texture = tex.overlay.get();
         }
 
-        int w = tex.overlay.tex.width;
-        int h = tex.overlay.tex.height;
+        int w = texture ? texture->tex.width : 0;
+        int h = texture ? texture->tex.height : 0;
         int y = 0;
         switch (pos)
         {
@@ -353,14 +363,15 @@ class view_title_overlay_t : public wf::scale_transformer_t::overlay_t
         view_title_texture_t& title = get_overlay_texture(find_toplevel_parent(
             tr.get_transformed_view()));
 
-        GLuint tex = title.overlay.tex.tex;
-
-        if (tex == (GLuint) - 1)
+        auto texture = title.overlay.get();
+        if (!texture)
         {
-            /* this should not happen */
+            /* the text is still being rendered */
             return;
         }
 
+        GLuint tex = texture->tex.tex;
+
         auto ortho = fb.get_orthographic_projection();
         OpenGL::render_begin(fb);
         for (const auto& box : damage)
@@ -381,10 +392,10 @@ class view_title_overlay_t : public wf::scale_transformer_t::overlay_t
         auto parent = find_toplevel_parent(view);
         auto& title = get_overlay_texture(parent);
 
-        if (title.overlay.tex.tex != (GLuint) - 1)
+        if (auto texture = title.overlay.get())
         {
             text_height = (unsigned int)std::ceil(
-                title.overlay.tex.height / title.par.output_scale);
+                texture->tex.height / title.par.output_scale);
         } else
         {
             text_height =
@@ -113,8 +113,27 @@ class scale_transformer_t : public wf::view_2D
     {
         /* render the transformed view first */
         view_transformer_t::render_with_damage(src_tex, src_box, damage, target_fb);
+        render_overlays(damage, target_fb);
+    }
 
-        /* call all overlays */
+    /* draw views with several surfaces without a snapshot, if possible */
+    bool render_surfaces_with_damage(
+        const std::vector<wf::surface_texture_t>& surfaces,
+        const wf::region_t& damage, const wf::framebuffer_t& target_fb) override
+    {
+        if (!render_surfaces_with_2D_transform(surfaces, damage, target_fb))
+        {
+            return false;
+        }
+
+        render_overlays(damage, target_fb);
+        return true;
+    }
+
+    /* call all overlays */
+    void render_overlays(const wf::region_t& damage,
+        const wf::framebuffer_t& target_fb)
+    {
         for (auto& p : overlays)
         {
             auto& ol = *(p.second);
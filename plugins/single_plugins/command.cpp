@@ -235,8 +235,13 @@ class wayfire_command : public wf::plugin_interface_t
         using namespace std::placeholders;
 
         setup_bindings_from_config();
-        reload_config.set_callback([=] (wf::signal_data_t*)
+        reload_config.set_callback([=] (wf::signal_data_t *data)
         {
+            if (!wf::config_section_changed(data, "command"))
+            {
+                return;
+            }
+
             setup_bindings_from_config();
         });
 
@@ -77,7 +77,7 @@ class wayfire_invert_screen : public wf::plugin_interface_t
                 output->render->rem_post(&hook);
             } else
             {
-                output->render->add_post(&hook);
+                output->render->add_post(&hook, true);
             }
 
             active = !active;
@@ -299,6 +299,13 @@ struct view_node_t::scale_transformer_t : public wf::view_2D
         this->translation_x = box.x - scaled_x;
         this->translation_y = box.y - scaled_y;
     }
+
+    bool render_surfaces_with_damage(
+        const std::vector<wf::surface_texture_t>& surfaces,
+        const wf::region_t& damage, const wf::framebuffer_t& target_fb) override
+    {
+        return render_surfaces_with_2D_transform(surfaces, damage, target_fb);
+    }
 };
 
 /**
@@ -60,8 +60,13 @@ class wayfire_window_rules_t : public wf::plugin_interface_t
     };
 
     // Auto-reload on changes to config file
-    wf::signal_connection_t _reload_config = [=] (wf::signal_data_t*)
+    wf::signal_connection_t _reload_config = [=] (wf::signal_data_t *data)
     {
+        if (!wf::config_section_changed(data, "window-rules"))
+        {
+            return;
+        }
+
         setup_rules_from_config();
     };
 
@@ -40,44 +40,45 @@
 #define GRID_WIDTH  4
 #define GRID_HEIGHT 4
 
-#define MODEL_MAX_SPRINGS (GRID_WIDTH * GRID_HEIGHT * 2)
+#define MODEL_NUM_OBJECTS (GRID_WIDTH * GRID_HEIGHT)
+
+/* Duration of a single physics step, in milliseconds */
+#define MODEL_STEP_MSEC 15.0f
 
 typedef struct _xy_pair {
     float x, y;
 } Point, Vector;
 
-typedef struct _Edge {
-    float next, prev;
-
-    float start;
-    float end;
+/*
+ * The objects of the model are stored as separate arrays of their attributes,
+ * so that each physics step is a handful of loops over MODEL_NUM_OBJECTS
+ * floats, which the compiler can turn into SIMD instructions.
+ *
+ * The springs are not stored explicitly: each object is connected to its
+ * right and bottom neighbours in the grid, with the rest lengths hpad and vpad.
+ */
+typedef struct _Model {
+    /* Physics state after the last step */
+    float positionX[MODEL_NUM_OBJECTS];
+    float positionY[MODEL_NUM_OBJECTS];
+    float velocityX[MODEL_NUM_OBJECTS];
+    float velocityY[MODEL_NUM_OBJECTS];
 
-    float attract;
-    float velocity;
-} Edge;
+    /* Physics state before the last step */
+    float prevX[MODEL_NUM_OBJECTS];
+    float prevY[MODEL_NUM_OBJECTS];
 
-typedef struct _Object {
-    Vector	 force;
-    Point	 position;
-    Vector	 velocity;
-    float	 theta;
-    int		 immobile;
-    Edge	 vertEdge;
-    Edge	 horzEdge;
-} Object;
+    /* Interpolated between the previous and the current state, displayed */
+    float renderX[MODEL_NUM_OBJECTS];
+    float renderY[MODEL_NUM_OBJECTS];
 
-typedef struct _Spring {
-    Object *a;
-    Object *b;
-    Vector offset;
-} Spring;
+    /* 1.0 for objects which can move, 0.0 for immobile objects */
+    float mobile[MODEL_NUM_OBJECTS];
 
-typedef struct _Model {
-    Object	 *objects;
     int		 numObjects;
-    Spring	 springs[MODEL_MAX_SPRINGS];
-    int		 numSprings;
-    Object	 *anchorObject;
+    float	 hpad, vpad;
+    /* Index of the anchor object, or -1 */
+    int		 anchorObject;
     float	 steps;
     Point	 topLeft;
     Point	 bottomRight;
@@ -97,32 +98,21 @@ typedef struct _WobblyWindow {
 #define WobblyForce    (1L << 1)
 #define WobblyVelocity (1L << 2)
 
-static void objectInit(Object *object, float positionX, float positionY,
-        float velocityX, float velocityY)
+/* Move an object without animating the move */
+static void modelSetPosition(Model *model, int i, float x, float y)
 {
-    object->force.x = 0;
-    object->force.y = 0;
-
-    object->position.x = positionX;
-    object->position.y = positionY;
-
-    object->velocity.x = velocityX;
-    object->velocity.y = velocityY;
-
-    object->theta    = 0;
-    object->immobile = 0;
+    model->positionX[i] = model->prevX[i] = model->renderX[i] = x;
+    model->positionY[i] = model->prevY[i] = model->renderY[i] = y;
+}
 
-    object->vertEdge.next = 0.0f;
-    object->horzEdge.next = 0.0f;
+static void modelSetImmobile(Model *model, int i, int immobile)
+{
+    model->mobile[i] = immobile ? 0.0f : 1.0f;
 }
 
-static void springInit(Spring *spring, Object *a, Object *b,
-	    float offsetX, float offsetY)
+static int modelIsImmobile(Model *model, int i)
 {
-    spring->a	     = a;
-    spring->b	     = b;
-    spring->offset.x = offsetX;
-    spring->offset.y = offsetY;
+    return model->mobile[i] == 0.0f;
 }
 
 static void modelCalcBounds(Model *model)
@@ -136,27 +126,21 @@ static void modelCalcBounds(Model *model)
 
     for (i = 0; i < model->numObjects; i++)
     {
-        if (model->objects[i].position.x < model->topLeft.x)
-            model->topLeft.x = model->objects[i].position.x;
-        else if (model->objects[i].position.x > model->bottomRight.x)
-            model->bottomRight.x = model->objects[i].position.x;
-
-        if (model->objects[i].position.y < model->topLeft.y)
-            model->topLeft.y = model->objects[i].position.y;
-        else if (model->objects[i].position.y > model->bottomRight.y)
-            model->bottomRight.y = model->objects[i].position.y;
+        model->topLeft.x = fminf(model->topLeft.x, model->renderX[i]);
+        model->topLeft.y = fminf(model->topLeft.y, model->renderY[i]);
+        model->bottomRight.x = fmaxf(model->bottomRight.x, model->renderX[i]);
+        model->bottomRight.y = fmaxf(model->bottomRight.y, model->renderY[i]);
     }
 }
 
-static void modelAddSpring(Model *model, Object *a, Object *b,
-		float offsetX, float offsetY)
+static void modelSetAnchor(Model *model, int anchor, float x, float y)
 {
-    Spring *spring;
+    if (model->anchorObject >= 0)
+        modelSetImmobile(model, model->anchorObject, 0);
 
-    spring = &model->springs[model->numSprings];
-    model->numSprings++;
-
-    springInit (spring, a, b, offsetX, offsetY);
+    model->anchorObject = anchor;
+    modelSetPosition(model, anchor, x, y);
+    modelSetImmobile(model, anchor, 1);
 }
 
 static void modelSetMiddleAnchor(Model *model, int x, int y,
@@ -167,15 +151,8 @@ static void modelSetMiddleAnchor(Model *model, int x, int y,
     gx = ((GRID_WIDTH  - 1) / 2 * width)  / (float) (GRID_WIDTH  - 1);
     gy = ((GRID_HEIGHT - 1) / 2 * height) / (float) (GRID_HEIGHT - 1);
 
-    if (model->anchorObject)
-        model->anchorObject->immobile = 0;
-
-    model->anchorObject =
-        &model->objects[GRID_WIDTH * ((GRID_HEIGHT-1)/2) + (GRID_WIDTH-1)/ 2];
-    model->anchorObject->position.x = x + gx;
-    model->anchorObject->position.y = y + gy;
-
-    model->anchorObject->immobile = 1;
+    modelSetAnchor(model,
+        GRID_WIDTH * ((GRID_HEIGHT-1)/2) + (GRID_WIDTH-1)/ 2, x + gx, y + gy);
 }
 
 static void modelSetTopAnchor(Model *model, int x, int y,
@@ -184,15 +161,7 @@ static void modelSetTopAnchor(Model *model, int x, int y,
     float gx;
 
     gx = ((GRID_WIDTH  - 1) / 2 * width)  / (float) (GRID_WIDTH  - 1);
-
-    if (model->anchorObject)
-	model->anchorObject->immobile = 0;
-
-    model->anchorObject = &model->objects[(GRID_WIDTH-1)/ 2];
-    model->anchorObject->position.x = x + gx;
-    model->anchorObject->position.y = y;
-
-    model->anchorObject->immobile = 1;
+    modelSetAnchor(model, (GRID_WIDTH-1)/ 2, x + gx, y);
 }
 
 static void modelInitObjects(Model *model, int x, int y, int width, int height)
@@ -207,47 +176,24 @@ static void modelInitObjects(Model *model, int x, int y, int width, int height)
     {
         for (gridX = 0; gridX < GRID_WIDTH; gridX++)
         {
-            objectInit (&model->objects[i],
+            modelSetPosition(model, i,
                     x + (gridX * width) / gw,
-                    y + (gridY * height) / gh,
-                    0, 0);
+                    y + (gridY * height) / gh);
+            model->velocityX[i] = 0;
+            model->velocityY[i] = 0;
+            model->mobile[i] = 1.0f;
             i++;
         }
     }
 
-    if (!model->anchorObject)
+    if (model->anchorObject < 0)
         modelSetMiddleAnchor (model, x, y, width, height);
 }
 
 static void modelInitSprings(Model *model, int width, int height)
 {
-    int   gridX, gridY, i = 0;
-    float hpad, vpad;
-
-    model->numSprings = 0;
-
-    hpad = ((float) width) / (GRID_WIDTH  - 1);
-    vpad = ((float) height) / (GRID_HEIGHT - 1);
-
-    for (gridY = 0; gridY < GRID_HEIGHT; gridY++)
-    {
-        for (gridX = 0; gridX < GRID_WIDTH; gridX++)
-        {
-            if (gridX > 0)
-            {
-                modelAddSpring (model, &model->objects[i - 1],
-                        &model->objects[i], hpad, 0);
-            }
-
-            if (gridY > 0)
-            {
-                modelAddSpring (model, &model->objects[i - GRID_WIDTH],
-                        &model->objects[i], 0, vpad);
-            }
-
-            i++;
-        }
-    }
+    model->hpad = ((float) width) / (GRID_WIDTH  - 1);
+    model->vpad = ((float) height) / (GRID_HEIGHT - 1);
 }
 
 static Model * createModel(int x, int y, int width, int height)
@@ -258,16 +204,8 @@ static Model * createModel(int x, int y, int width, int height)
     if (!model)
         return 0;
 
-    model->numObjects = GRID_WIDTH * GRID_HEIGHT;
-    model->objects = malloc (sizeof (Object) * model->numObjects);
-    if (!model->objects)
-    {
-        free (model);
-        return 0;
-    }
-
-    model->anchorObject = 0;
-    model->numSprings = 0;
+    model->numObjects = MODEL_NUM_OBJECTS;
+    model->anchorObject = -1;
     model->steps = 0;
 
     modelInitObjects (model, x, y, width, height);
@@ -277,96 +215,136 @@ static Model * createModel(int x, int y, int width, int height)
     return model;
 }
 
-static void objectApplyForce(Object *object, float fx, float fy)
-{
-    object->force.x += fx;
-    object->force.y += fy;
-}
-
-static void springExertForces(Spring *spring, float k)
+/*
+ * Run a single physics step.
+ *
+ * The spring between objects a and b pulls each of them with the force
+ * k/2 * (b - a - offset), towards the other object.
+ */
+static void modelStepOnce(Model *model, float friction, float k,
+        float *velocitySum, float *forceSum)
 {
-    Vector da, db;
-    Vector a, b;
-
-    a = spring->a->position;
-    b = spring->b->position;
-
-    da.x = 0.5f * (b.x - a.x - spring->offset.x);
-    da.y = 0.5f * (b.y - a.y - spring->offset.y);
+    float forceX[MODEL_NUM_OBJECTS], forceY[MODEL_NUM_OBJECTS];
+    float dX[MODEL_NUM_OBJECTS], dY[MODEL_NUM_OBJECTS];
+    const float hk = 0.5f * k;
+    int i;
 
-    db.x = 0.5f * (a.x - b.x + spring->offset.x);
-    db.y = 0.5f * (a.y - b.y + spring->offset.y);
+    for (i = 0; i < MODEL_NUM_OBJECTS; i++)
+    {
+        model->prevX[i] = model->positionX[i];
+        model->prevY[i] = model->positionY[i];
+    }
 
-    objectApplyForce (spring->a, k * da.x, k * da.y);
-    objectApplyForce (spring->b, k * db.x, k * db.y);
-}
+    /* Horizontal springs, dX[i] is the spring between i - 1 and i */
+    dX[0] = dY[0] = 0;
+    for (i = 1; i < MODEL_NUM_OBJECTS; i++)
+    {
+        float connected = (i % GRID_WIDTH) ? 1.0f : 0.0f;
+        dX[i] = connected * hk *
+            (model->positionX[i] - model->positionX[i - 1] - model->hpad);
+        dY[i] = connected * hk *
+            (model->positionY[i] - model->positionY[i - 1]);
+    }
 
-static float modelStepObject(Object *object, float friction, float *force)
-{
-    object->theta += 0.05f;
+    for (i = 0; i < MODEL_NUM_OBJECTS; i++)
+    {
+        float nextX = (i + 1 < MODEL_NUM_OBJECTS) ? dX[i + 1] : 0;
+        float nextY = (i + 1 < MODEL_NUM_OBJECTS) ? dY[i + 1] : 0;
+        forceX[i] = nextX - dX[i];
+        forceY[i] = nextY - dY[i];
+    }
 
-    if (object->immobile)
+    /* Vertical springs, dX[i] is the spring between i and i + GRID_WIDTH */
+    for (i = 0; i < MODEL_NUM_OBJECTS - GRID_WIDTH; i++)
     {
-        object->velocity.x = 0.0f;
-        object->velocity.y = 0.0f;
-        object->force.x = 0.0f;
-        object->force.y = 0.0f;
+        dX[i] = hk * (model->positionX[i + GRID_WIDTH] - model->positionX[i]);
+        dY[i] = hk *
+            (model->positionY[i + GRID_WIDTH] - model->positionY[i] - model->vpad);
+    }
 
-        *force = 0.0f;
-        return 0.0f;
+    for (i = 0; i < MODEL_NUM_OBJECTS - GRID_WIDTH; i++)
+    {
+        forceX[i] += dX[i];
+        forceY[i] += dY[i];
     }
-    else
+
+    for (i = GRID_WIDTH; i < MODEL_NUM_OBJECTS; i++)
     {
-        object->force.x -= friction * object->velocity.x;
-        object->force.y -= friction * object->velocity.y;
+        forceX[i] -= dX[i - GRID_WIDTH];
+        forceY[i] -= dY[i - GRID_WIDTH];
+    }
 
-        object->velocity.x += object->force.x / WOBBLY_MASS;
-        object->velocity.y += object->force.y / WOBBLY_MASS;
+    /* Integrate, immobile objects keep their position and have no velocity */
+    for (i = 0; i < MODEL_NUM_OBJECTS; i++)
+    {
+        float fx = forceX[i] - friction * model->velocityX[i];
+        float fy = forceY[i] - friction * model->velocityY[i];
 
-        object->position.x += object->velocity.x;
-        object->position.y += object->velocity.y;
+        model->velocityX[i] =
+            model->mobile[i] * (model->velocityX[i] + fx / WOBBLY_MASS);
+        model->velocityY[i] =
+            model->mobile[i] * (model->velocityY[i] + fy / WOBBLY_MASS);
 
-        *force = fabs(object->force.x) + fabs(object->force.y);
+        model->positionX[i] += model->velocityX[i];
+        model->positionY[i] += model->velocityY[i];
 
-        object->force.x = 0.0f;
-        object->force.y = 0.0f;
+        *forceSum += model->mobile[i] * (fabsf(fx) + fabsf(fy));
+        *velocitySum += fabsf(model->velocityX[i]) + fabsf(model->velocityY[i]);
+    }
+}
 
-        return fabs(object->velocity.x) + fabs(object->velocity.y);
+/* Update the displayed state, @alpha is the fraction of the next step which
+ * has already elapsed */
+static void modelInterpolate(Model *model, float alpha)
+{
+    int i;
+    for (i = 0; i < MODEL_NUM_OBJECTS; i++)
+    {
+        model->renderX[i] = model->prevX[i] +
+            alpha * (model->positionX[i] - model->prevX[i]);
+        model->renderY[i] = model->prevY[i] +
+            alpha * (model->positionY[i] - model->prevY[i]);
     }
 }
 
-static int modelStep(Model *model, float friction, float k, float time)
+/*
+ * Advance the model by @time milliseconds in steps of fixed length, and
+ * interpolate the displayed state for the remainder.
+ *
+ * @return The new wobbly state, or @wobbly if the time was too short for a
+ * whole step.
+ */
+static int modelStep(Model *model, float friction, float k, float time,
+        int wobbly)
 {
-    int   i, j, steps, wobbly = 0;
+    int   j, steps;
     float velocitySum = 0.0f;
-    float force, forceSum = 0.0f;
+    float forceSum = 0.0f;
 
-    model->steps += time / 15.0f;
+    model->steps += time / MODEL_STEP_MSEC;
     steps = floor (model->steps);
     model->steps -= steps;
 
     if (!steps)
-        return 1;
-
-    for (j = 0; j < steps; j++)
     {
-        for (i = 0; i < model->numSprings; i++)
-            springExertForces (&model->springs[i], k);
-
-        for (i = 0; i < model->numObjects; i++)
-        {
-            velocitySum += modelStepObject(&model->objects[i], friction, &force);
-            forceSum += force;
-        }
+        modelInterpolate(model, model->steps);
+        modelCalcBounds(model);
+        return wobbly;
     }
 
-    modelCalcBounds (model);
+    for (j = 0; j < steps; j++)
+        modelStepOnce(model, friction, k, &velocitySum, &forceSum);
 
+    wobbly = 0;
     if (velocitySum > 0.5f)
         wobbly |= WobblyVelocity;
     if (forceSum > 20.0f)
         wobbly |= WobblyForce;
 
+    /* Once the model has settled, display its final state */
+    modelInterpolate(model, wobbly ? model->steps : 1.0f);
+    modelCalcBounds (model);
+
     return wobbly;
 }
 
@@ -394,9 +372,9 @@ static void bezierPatchEvaluate (Model *model, float u, float v,
         for (j = 0; j < 4; j++)
         {
             x += coeffsU[i] * coeffsV[j] *
-                model->objects[j * GRID_WIDTH + i].position.x;
+                model->renderX[j * GRID_WIDTH + i];
             y += coeffsU[i] * coeffsV[j] *
-                model->objects[j * GRID_HEIGHT + i].position.y;
+                model->renderY[j * GRID_WIDTH + i];
         }
     }
 
@@ -419,117 +397,115 @@ static int wobblyEnsureModel(struct wobbly_surface *surface)
     return 1;
 }
 
-static float objectDistance(Object *object, float x, float y)
+static float objectDistance(Model *model, int i, float x, float y)
 {
     float dx, dy;
-    dx = object->position.x - x;
-    dy = object->position.y - y;
+    dx = model->positionX[i] - x;
+    dy = model->positionY[i] - y;
 
     return sqrt(dx * dx + dy * dy);
 }
 
-static Object *modelFindNearestObject(Model *model, float x, float y)
+static int modelFindNearestObject(Model *model, float x, float y)
 {
-    Object *object = &model->objects[0];
+    int    object = 0;
     float  distance, minDistance = 0.0;
     int    i;
 
     for (i = 0; i < model->numObjects; i++)
     {
-        distance = objectDistance(&model->objects[i], x, y);
+        distance = objectDistance(model, i, x, y);
         if (i == 0 || distance < minDistance)
         {
             minDistance = distance;
-            object = &model->objects[i];
+            object = i;
         }
     }
 
     return object;
 }
 
+/* Give the neighbours of the given object a push away from it */
+static void modelPushNeighbours(Model *model, int i)
+{
+    if (i % GRID_WIDTH > 0)
+        model->velocityX[i - 1] += model->hpad * 0.05f;
+    if (i % GRID_WIDTH < GRID_WIDTH - 1)
+        model->velocityX[i + 1] -= model->hpad * 0.05f;
+    if (i >= GRID_WIDTH)
+        model->velocityY[i - GRID_WIDTH] += model->vpad * 0.05f;
+    if (i < model->numObjects - GRID_WIDTH)
+        model->velocityY[i + GRID_WIDTH] -= model->vpad * 0.05f;
+}
+
 static void modelAdjustCorners(Model *model, int x, int y,
         int width, int height, int make_immobile)
 {
-    Object *o;
-    o = &model->objects[0];
-    o->position.x = x;
-    o->position.y = y;
-    o->immobile = make_immobile;
+    int o;
+    o = 0;
+    modelSetPosition(model, o, x, y);
+    modelSetImmobile(model, o, make_immobile);
 
-    o = &model->objects[GRID_WIDTH - 1];
-    o->position.x = x + width;
-    o->position.y = y;
-    o->immobile = make_immobile;
+    o = GRID_WIDTH - 1;
+    modelSetPosition(model, o, x + width, y);
+    modelSetImmobile(model, o, make_immobile);
 
-    o = &model->objects[GRID_WIDTH * (GRID_HEIGHT - 1)];
-    o->position.x = x;
-    o->position.y = y + height;
-    o->immobile = make_immobile;
+    o = GRID_WIDTH * (GRID_HEIGHT - 1);
+    modelSetPosition(model, o, x, y + height);
+    modelSetImmobile(model, o, make_immobile);
 
-    o = &model->objects[model->numObjects - 1];
-    o->position.x = x + width;
-    o->position.y = y + height;
-    o->immobile = make_immobile;
+    o = model->numObjects - 1;
+    modelSetPosition(model, o, x + width, y + height);
+    modelSetImmobile(model, o, make_immobile);
 
-    if (!model->anchorObject)
-        model->anchorObject = &model->objects[0];
+    if (model->anchorObject < 0)
+        model->anchorObject = 0;
 }
 
 static int modelRemoveEdgeAnchors(Model *model)
 {
-    int result = 0;
-    Object *o;
+    const int corners[] = {
+        0, GRID_WIDTH - 1,
+        GRID_WIDTH * (GRID_HEIGHT - 1), model->numObjects - 1,
+    };
 
-    o = &model->objects[0];
-    if (o != model->anchorObject)
-    {
-        result |= o->immobile;
-        o->immobile = 0;
-    }
-
-    o = &model->objects[GRID_WIDTH - 1];
-    if (o != model->anchorObject)
-    {
-        result |= o->immobile;
-        o->immobile = 0;
-    }
-
-    o = &model->objects[GRID_WIDTH * (GRID_HEIGHT - 1)];
-    if (o != model->anchorObject)
-    {
-        result |= o->immobile;
-        o->immobile = 0;
-    }
+    int result = 0;
+    int i;
 
-    o = &model->objects[model->numObjects - 1];
-    if (o != model->anchorObject)
+    for (i = 0; i < 4; i++)
     {
-        result |= o->immobile;
-        o->immobile = 0;
+        if (corners[i] != model->anchorObject)
+        {
+            result |= modelIsImmobile(model, corners[i]);
+            modelSetImmobile(model, corners[i], 0);
+        }
     }
 
     return result;
 }
 
-void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint)
+void wobbly_prepare_paint_batch(struct wobbly_surface **surfaces, int count,
+        int msSinceLastPaint)
 {
-    WobblyWindow *ww = surface->ww;
     float  friction, springK;
+    int    i;
 
     friction = wobbly_settings_get_friction();
     springK  = wobbly_settings_get_spring_k();
 
-    if (ww->wobbly)
+    for (i = 0; i < count; i++)
     {
+        struct wobbly_surface *surface = surfaces[i];
+        WobblyWindow *ww = surface->ww;
+
         if (ww->wobbly & (WobblyInitial | WobblyVelocity | WobblyForce))
         {
             ww->wobbly = modelStep(ww->model, friction, springK,
                     (ww->wobbly & WobblyVelocity) ?
-                    msSinceLastPaint : 16);
+                    msSinceLastPaint : 16, ww->wobbly);
 
-            if (ww->wobbly) {
-                modelCalcBounds(ww->model);
-            } else {
+            if (!ww->wobbly)
+            {
                 surface->x = ww->model->topLeft.x;
                 surface->y = ww->model->topLeft.y;
                 surface->synced = 1;
@@ -538,6 +514,11 @@ void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint)
     }
 }
 
+void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint)
+{
+    wobbly_prepare_paint_batch(&surface, 1, msSinceLastPaint);
+}
+
 void wobbly_done_paint(struct wobbly_surface *surface)
 {
     WobblyWindow *ww = (WobblyWindow*)surface->ww;
@@ -615,8 +596,8 @@ void wobbly_move_notify(struct wobbly_surface *surface, int x, int y)
     WobblyWindow *ww = surface->ww;
     if (ww->grabbed)
     {
-        ww->model->anchorObject->position.x = x + ww->grab_dx;
-        ww->model->anchorObject->position.y = y + ww->grab_dy;
+        modelSetPosition(ww->model, ww->model->anchorObject,
+            x + ww->grab_dx, y + ww->grab_dy);
 
         ww->wobbly |= WobblyInitial;
         surface->synced = 0;
@@ -628,28 +609,9 @@ void wobbly_slight_wobble(struct wobbly_surface *surface)
     WobblyWindow *ww = surface->ww;
     if (wobblyEnsureModel(surface))
     {
-        Object *centerObj;
-        Spring *s;
-        int	   i;
-
-        centerObj = modelFindNearestObject(ww->model,
+        int centerObj = modelFindNearestObject(ww->model,
             surface->x + surface->width / 2, surface->y + surface->height / 2);
-
-        for (i = 0; i < ww->model->numSprings; i++)
-        {
-            s = &ww->model->springs[i];
-
-            if (s->a == centerObj)
-            {
-                s->b->velocity.x -= s->offset.x * 0.05f;
-                s->b->velocity.y -= s->offset.y * 0.05f;
-            }
-            else if (s->b == centerObj)
-            {
-                s->a->velocity.x += s->offset.x * 0.05f;
-                s->a->velocity.y += s->offset.y * 0.05f;
-            }
-        }
+        modelPushNeighbours(ww->model, centerObj);
 
         ww->wobbly |= WobblyInitial;
     }
@@ -671,33 +633,20 @@ void wobbly_grab_notify(struct wobbly_surface *surface, int x, int y)
 
     if (wobblyEnsureModel(surface))
     {
-        Spring *s;
-        int	   i;
+        Model *model = ww->model;
+        int anchor;
 
-        if (ww->model->anchorObject)
-            ww->model->anchorObject->immobile = 0;
+        if (model->anchorObject >= 0)
+            modelSetImmobile(model, model->anchorObject, 0);
 
-        ww->model->anchorObject = modelFindNearestObject(ww->model, x, y);
-        ww->model->anchorObject->immobile = 1;
-        ww->grab_dx = ww->model->anchorObject->position.x - x;
-        ww->grab_dy = ww->model->anchorObject->position.y - y;
+        anchor = modelFindNearestObject(model, x, y);
+        model->anchorObject = anchor;
+        modelSetImmobile(model, anchor, 1);
+        ww->grab_dx = model->positionX[anchor] - x;
+        ww->grab_dy = model->positionY[anchor] - y;
 
         ww->grabbed = 1;
-        for (i = 0; i < ww->model->numSprings; i++)
-        {
-            s = &ww->model->springs[i];
-
-            if (s->a == ww->model->anchorObject)
-            {
-                s->b->velocity.x -= s->offset.x * 0.05f;
-                s->b->velocity.y -= s->offset.y * 0.05f;
-            }
-            else if (s->b == ww->model->anchorObject)
-            {
-                s->a->velocity.x += s->offset.x * 0.05f;
-                s->a->velocity.y += s->offset.y * 0.05f;
-            }
-        }
+        modelPushNeighbours(model, anchor);
 
         ww->wobbly |= WobblyInitial;
     }
@@ -710,10 +659,10 @@ void wobbly_ungrab_notify(struct wobbly_surface *surface)
     {
         if (ww->model)
         {
-            if (ww->model->anchorObject)
-                ww->model->anchorObject->immobile = 0;
+            if (ww->model->anchorObject >= 0)
+                modelSetImmobile(ww->model, ww->model->anchorObject, 0);
 
-            ww->model->anchorObject = NULL;
+            ww->model->anchorObject = -1;
 
             ww->wobbly |= WobblyInitial;
         }
@@ -751,9 +700,9 @@ void wobbly_fini(struct wobbly_surface *surface)
 
     if (ww->model)
     {
-        free(ww->model->objects);
         free(ww->model);
         free(surface->v);
+        free(surface->uv);
     }
 
     free (ww);
@@ -766,10 +715,10 @@ void wobbly_force_geometry(struct wobbly_surface *surface,
 
     if (wobblyEnsureModel(surface))
     {
-		if (!ww->grabbed && ww->model->anchorObject)
+		if (!ww->grabbed && ww->model->anchorObject >= 0)
 		{
-		    ww->model->anchorObject->immobile = 0;
-		    ww->model->anchorObject = NULL;
+		    modelSetImmobile(ww->model, ww->model->anchorObject, 0);
+		    ww->model->anchorObject = -1;
 		}
 
         surface->x = x;
@@ -793,7 +742,8 @@ void wobbly_unenforce_geometry(struct wobbly_surface *surface)
     {
         if (modelRemoveEdgeAnchors(ww->model))
         {
-            if (!ww->model->anchorObject || !ww->model->anchorObject->immobile)
+            if (ww->model->anchorObject < 0 ||
+                !modelIsImmobile(ww->model, ww->model->anchorObject))
             {
                 modelSetMiddleAnchor(ww->model, surface->x, surface->y,
                     surface->width, surface->height);
@@ -810,16 +760,21 @@ void wobbly_translate(struct wobbly_surface *surface, int dx, int dy)
     WobblyWindow *ww = surface->ww;
     if (wobblyEnsureModel(surface))
     {
-        for (int i = 0; i < ww->model->numObjects; i++)
+        Model *model = ww->model;
+        for (int i = 0; i < model->numObjects; i++)
         {
-            ww->model->objects[i].position.x += dx;
-            ww->model->objects[i].position.y += dy;
+            model->positionX[i] += dx;
+            model->positionY[i] += dy;
+            model->prevX[i] += dx;
+            model->prevY[i] += dy;
+            model->renderX[i] += dx;
+            model->renderY[i] += dy;
         }
 
-        ww->model->topLeft.x += dx;
-        ww->model->topLeft.y += dy;
-        ww->model->bottomRight.x += dx;
-        ww->model->bottomRight.y += dy;
+        model->topLeft.x += dx;
+        model->topLeft.y += dy;
+        model->bottomRight.x += dx;
+        model->bottomRight.y += dy;
     }
 }
 
@@ -833,16 +788,21 @@ void wobbly_scale(struct wobbly_surface *surface, double dx, double dy)
     WobblyWindow *ww = surface->ww;
     if (wobblyEnsureModel(surface))
     {
-        for (int i = 0; i < ww->model->numObjects; i++)
+        Model *model = ww->model;
+        for (int i = 0; i < model->numObjects; i++)
         {
-            scale(surface->x, &ww->model->objects[i].position.x, dx);
-            scale(surface->y, &ww->model->objects[i].position.y, dy);
+            scale(surface->x, &model->positionX[i], dx);
+            scale(surface->y, &model->positionY[i], dy);
+            scale(surface->x, &model->prevX[i], dx);
+            scale(surface->y, &model->prevY[i], dy);
+            scale(surface->x, &model->renderX[i], dx);
+            scale(surface->y, &model->renderY[i], dy);
         }
 
-        scale(surface->x, &ww->model->topLeft.x, dx);
-        scale(surface->y, &ww->model->topLeft.y, dy);
-        scale(surface->x, &ww->model->bottomRight.x, dx);
-        scale(surface->y, &ww->model->bottomRight.y, dy);
+        scale(surface->x, &model->topLeft.x, dx);
+        scale(surface->y, &model->topLeft.y, dy);
+        scale(surface->x, &model->bottomRight.x, dx);
+        scale(surface->y, &model->bottomRight.y, dy);
     }
 }
 
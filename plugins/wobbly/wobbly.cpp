@@ -5,6 +5,8 @@
 #include <wayfire/workspace-manager.hpp>
 #include <wayfire/render-manager.hpp>
 
+#include <algorithm>
+
 extern "C"
 {
 #include "wobbly.h"
@@ -46,6 +48,8 @@ void main()
 }
 
 OpenGL::program_t program;
+OpenGL::attrib_handle_t position_attrib, uv_attrib;
+OpenGL::uniform_handle_t mvp_uniform;
 int times_loaded = 0;
 
 void load_program()
@@ -57,6 +61,9 @@ void load_program()
 
     OpenGL::render_begin();
     program.compile(vertex_source, frag_source);
+    position_attrib = program.get_attrib("position");
+    uv_attrib   = program.get_attrib("uvPosition");
+    mvp_uniform = program.get_uniform("MVP");
     OpenGL::render_end();
 }
 
@@ -131,9 +138,9 @@ void render_triangles(wf::texture_t tex, glm::mat4 mat, float *pos, float *uv,
     program.use(tex.type);
     program.set_active_texture(tex);
 
-    program.attrib_pointer("position", 2, 0, pos);
-    program.attrib_pointer("uvPosition", 2, 0, uv);
-    program.uniformMatrix4f("MVP", mat);
+    program.attrib_pointer(position_attrib, 2, 0, pos);
+    program.attrib_pointer(uv_attrib, 2, 0, uv);
+    program.uniformMatrix4f(mvp_uniform, mat);
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -548,10 +555,44 @@ class wobbly_state_free_t : public iwobbly_state_t
 };
 }
 
+class wf_wobbly;
+
+/**
+ * Steps the models of all wobbly views on an output together, once per frame,
+ * instead of having a separate frame hook for each view.
+ */
+class wobbly_physics_engine_t : public wf::custom_data_t
+{
+  public:
+    void add(wf::output_t *output, wf_wobbly *wobbly);
+    void remove(wf_wobbly *wobbly);
+
+    /**
+     * Stop stepping the models. Must be called before the engine is erased
+     * from the output, because it is destroyed when the output is, and then
+     * the render manager may be gone already.
+     */
+    void stop();
+
+  private:
+    wf::output_t *output = nullptr;
+    std::vector<wf_wobbly*> active;
+    std::vector<wobbly_surface*> surfaces;
+    uint32_t last_frame;
+
+    wf::effect_hook_t pre_hook = [=] () { step(); };
+    void step();
+};
+
+static wobbly_physics_engine_t *get_physics_engine(wf::output_t *output)
+{
+    return output->get_data_safe<wobbly_physics_engine_t>().get();
+}
+
 class wf_wobbly : public wf::view_transformer_t
 {
     wayfire_view view;
-    wf::effect_hook_t pre_hook;
+    wobbly_physics_engine_t *engine = nullptr;
 
     wf::signal_connection_t view_removed = [=] (wf::signal_data_t*)
     {
@@ -579,11 +620,10 @@ class wf_wobbly : public wf::view_transformer_t
     {
         auto sig = static_cast<wf::_output_signal*>(data);
 
+        engine->remove(this);
+        engine = nullptr;
         if (!view->get_output())
         {
-            // Destructor won't be able to disconnect bc view output is invalid
-            sig->output->render->rem_effect(&pre_hook);
-
             return destroy_self();
         }
 
@@ -596,9 +636,8 @@ class wf_wobbly : public wf::view_transformer_t
         state->translate_model(old_geometry.x - new_geometry.x,
             old_geometry.y - new_geometry.y);
 
-        sig->output->render->rem_effect(&pre_hook);
-        view->get_output()->render->add_effect(&pre_hook,
-            wf::OUTPUT_EFFECT_PRE);
+        engine = get_physics_engine(view->get_output());
+        engine->add(view->get_output(), this);
 
         on_workspace_changed.disconnect();
         view->get_output()->connect_signal("workspace-changed",
@@ -607,7 +646,6 @@ class wf_wobbly : public wf::view_transformer_t
 
     std::unique_ptr<wobbly_surface> model;
     std::unique_ptr<wf::iwobbly_state_t> state;
-    uint32_t last_frame;
 
     void init_model()
     {
@@ -635,10 +673,9 @@ class wf_wobbly : public wf::view_transformer_t
     {
         this->view = view;
         init_model();
-        last_frame = wf::get_current_time();
 
-        pre_hook = [=] () { update_model(); };
-        view->get_output()->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+        engine = get_physics_engine(view->get_output());
+        engine->add(view->get_output(), this);
         view->get_output()->connect_signal("workspace-changed",
             &on_workspace_changed);
 
@@ -683,7 +720,11 @@ class wf_wobbly : public wf::view_transformer_t
         return point;
     }
 
-    void update_model()
+    /**
+     * Prepare the model for the next physics step.
+     * @return The model to step.
+     */
+    wobbly_surface *prepare_frame()
     {
         view->damage();
 
@@ -693,12 +734,13 @@ class wf_wobbly : public wf::view_transformer_t
         state->handle_frame();
         view->connect_signal("geometry-changed", &this->view_geometry_changed);
 
-        /* Update all the wobbly model */
-        auto now = wf::get_current_time();
-        wobbly_prepare_paint(model.get(), now - last_frame);
+        return model.get();
+    }
 
+    /** Update the view after the physics step, may destroy the transformer. */
+    void finish_frame()
+    {
         /* Update wobbly geometry */
-        last_frame = now;
         wobbly_add_geometry(model.get());
         wobbly_done_paint(model.get());
         view->damage();
@@ -880,9 +922,9 @@ class wf_wobbly : public wf::view_transformer_t
         state = nullptr;
         wobbly_fini(model.get());
 
-        if (view->get_output())
+        if (engine)
         {
-            view->get_output()->render->rem_effect(&pre_hook);
+            engine->remove(this);
         }
     }
 
@@ -892,6 +934,66 @@ class wf_wobbly : public wf::view_transformer_t
     wf_wobbly& operator =(wf_wobbly&&) = delete;
 };
 
+void wobbly_physics_engine_t::add(wf::output_t *output, wf_wobbly *wobbly)
+{
+    this->output = output;
+    if (active.empty())
+    {
+        last_frame = wf::get_current_time();
+        output->render->add_effect(&pre_hook, wf::OUTPUT_EFFECT_PRE);
+    }
+
+    active.push_back(wobbly);
+}
+
+void wobbly_physics_engine_t::remove(wf_wobbly *wobbly)
+{
+    auto it = std::find(active.begin(), active.end(), wobbly);
+    if (it == active.end())
+    {
+        return;
+    }
+
+    active.erase(it);
+    if (active.empty())
+    {
+        output->render->rem_effect(&pre_hook);
+    }
+}
+
+void wobbly_physics_engine_t::stop()
+{
+    if (!active.empty())
+    {
+        output->render->rem_effect(&pre_hook);
+        active.clear();
+    }
+}
+
+void wobbly_physics_engine_t::step()
+{
+    /* Views are removed from the list when their animation ends */
+    auto stepped = active;
+
+    surfaces.clear();
+    for (auto& wobbly : stepped)
+    {
+        surfaces.push_back(wobbly->prepare_frame());
+    }
+
+    auto now = wf::get_current_time();
+    wobbly_prepare_paint_batch(surfaces.data(), surfaces.size(), now - last_frame);
+    last_frame = now;
+
+    for (auto& wobbly : stepped)
+    {
+        if (std::find(active.begin(), active.end(), wobbly) != active.end())
+        {
+            wobbly->finish_frame();
+        }
+    }
+}
+
 class wayfire_wobbly : public wf::plugin_interface_t
 {
     wf::signal_connection_t wobbly_changed;
@@ -987,6 +1089,13 @@ class wayfire_wobbly : public wf::plugin_interface_t
             }
         }
 
+        /* The engine must not outlive the plugin, its code is unloaded */
+        if (auto engine = output->get_data<wobbly_physics_engine_t>())
+        {
+            engine->stop();
+            output->erase_data<wobbly_physics_engine_t>();
+        }
+
         wobbly_graphics::destroy_program();
         output->disconnect_signal(&wobbly_changed);
     }
@@ -48,6 +48,10 @@ void wobbly_scale(struct wobbly_surface *surface, double dx, double dy);
 void wobbly_resize(struct wobbly_surface *surface, int width, int height);
 void wobbly_move_notify(struct wobbly_surface *surface, int x, int y);
 void wobbly_prepare_paint(struct wobbly_surface *surface, int msSinceLastPaint);
+/* Same as calling wobbly_prepare_paint() for each of the surfaces, but the
+ * settings are read only once for the whole batch. */
+void wobbly_prepare_paint_batch(struct wobbly_surface **surfaces, int count,
+    int msSinceLastPaint);
 void wobbly_done_paint(struct wobbly_surface *surface);
 void wobbly_add_geometry(struct wobbly_surface *surface);
 struct wobbly_rect wobbly_boundingbox(struct wobbly_surface *surface);
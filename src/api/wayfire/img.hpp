@@ -2,7 +2,11 @@
 #define IMG_HPP_
 
 #include <GLES2/gl2.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace image_io
 {
@@ -11,6 +15,99 @@ namespace image_io
  * Guaranteed: doesn't change any GL state except pixel packing */
 bool load_from_file(std::string name, GLuint target);
 
+/* The pixels of a decoded image, with 8 bits per channel, top row first */
+struct image_t
+{
+    int width    = 0;
+    int height   = 0;
+    /* 3 for RGB, 4 for RGBA */
+    int channels = 4;
+    std::vector<uint8_t> pixels;
+};
+
+using image_callback_t = std::function<void (std::shared_ptr<const image_t>)>;
+
+/* Decode the image from the given file on a worker thread, and call the
+ * callback on the compositor thread with the image, or with nullptr if it
+ * can't be loaded.
+ *
+ * The last decoded images are cached by path and modification time, so loading
+ * an unchanged file again (for ex. after a config reload) doesn't decode it
+ * again. In that case, the callback is called before load_async() returns. */
+void load_async(std::string name, image_callback_t callback);
+
+/* Uploads a decoded image to the bound texture in slices of rows, so that large
+ * images can be uploaded over several frames.
+ * For GL_TEXTURE_CUBE_MAP, the image must contain the faces in the layout
+ * expected by load_from_file(). */
+class texture_upload_t
+{
+  public:
+    texture_upload_t(std::shared_ptr<const image_t> image, GLuint target,
+        int rows_per_step = 256);
+
+    /* Whether the image can be uploaded to the target */
+    bool is_valid() const;
+
+    /* Upload the next slice to the bound texture.
+     * Guaranteed: doesn't change any GL state except pixel packing
+     * Returns true once the whole image has been uploaded */
+    bool step();
+
+  private:
+    std::shared_ptr<const image_t> image;
+    GLuint target;
+    int rows_per_step;
+    int face_width, face_height;
+    int nr_faces;
+    int face = 0, row = 0;
+    bool valid = true;
+};
+
+/* A texture loaded from a file with load_async(), and uploaded with
+ * texture_upload_t, one slice per call to update(). The previous image is
+ * kept until the new one has been completely uploaded. */
+class async_texture_t
+{
+  public:
+    /* @param target GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP */
+    async_texture_t(GLuint target);
+    ~async_texture_t();
+
+    async_texture_t(const async_texture_t&) = delete;
+    async_texture_t& operator =(const async_texture_t&) = delete;
+
+    /* Start loading the given file, unless it is already loaded or being
+     * loaded. @on_ready is called once the image has been decoded, for ex. to
+     * schedule a frame in which update() is called. */
+    void load(const std::string& name, std::function<void()> on_ready);
+
+    /* Continue uploading the image. Must be called between
+     * OpenGL::render_begin() and OpenGL::render_end().
+     * Returns true if the upload isn't finished yet */
+    bool update();
+
+    /* The texture with the last completely uploaded image, or -1 if there is
+     * none or if the last image couldn't be loaded */
+    GLuint get_texture() const;
+
+  private:
+    GLuint target;
+    GLuint tex = -1;
+    GLuint pending_tex = -1;
+    std::string name;
+    std::unique_ptr<texture_upload_t> upload;
+    /* The on_ready callback of the image being loaded. It is kept here rather
+     * than in the callback of load_async(), so that it is released together
+     * with the texture even if the image is still being decoded. */
+    std::function<void()> on_ready;
+    /* Callbacks of load_async() hold a weak reference, so that they are
+     * ignored after the texture is destroyed */
+    std::shared_ptr<async_texture_t*> self;
+
+    void apply_parameters();
+};
+
 /* Function that saves the given pixels(in rgba format) to a (currently) png file */
 void write_to_file(std::string name, uint8_t *pixels, int w, int h,
     std::string type);
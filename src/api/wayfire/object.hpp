@@ -4,6 +4,8 @@
 #include <typeinfo>
 #include <memory>
 #include <string>
+#include <functional>
+#include <cstdint>
 
 #include <wayfire/nonstd/observer_ptr.h>
 
@@ -25,6 +27,21 @@ struct signal_data_t
 using signal_callback_t = std::function<void (signal_data_t*)>;
 class signal_provider_t;
 
+/**
+ * An interned signal name. Connecting to and emitting signals by ID avoids
+ * hashing and copying the signal name each time.
+ */
+using signal_id_t = uint32_t;
+
+/**
+ * Get the ID of the signal with the given name. The same name always results
+ * in the same ID. Code which emits a signal often should look up its ID only
+ * once, for ex:
+ *
+ * static const wf::signal_id_t frame_signal = wf::get_signal_id("frame");
+ */
+signal_id_t get_signal_id(const std::string& name);
+
 /**
  * Provides an interface to connect to signal providers.
  *
@@ -73,12 +90,16 @@ class signal_provider_t
 {
   public:
     /** Register a connection to be called when the given signal is emitted. */
-    void connect_signal(std::string name, signal_connection_t *callback);
+    void connect_signal(const std::string& name, signal_connection_t *callback);
+    /** Same as the above, but the signal is given by its ID. */
+    void connect_signal(signal_id_t id, signal_connection_t *callback);
     /** Unregister a connection. */
     void disconnect_signal(signal_connection_t *callback);
 
     /** Emit the given signal. No type checking for data is required */
-    void emit_signal(std::string name, signal_data_t *data);
+    void emit_signal(const std::string& name, signal_data_t *data);
+    /** Same as the above, but the signal is given by its ID. */
+    void emit_signal(signal_id_t id, signal_data_t *data);
 
     virtual ~signal_provider_t();
 
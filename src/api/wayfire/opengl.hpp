@@ -8,6 +8,7 @@
 #include <wayfire/nonstd/wlroots.hpp>
 
 #include <wayfire/geometry.hpp>
+#include <wayfire/region.hpp>
 
 #define GLM_FORCE_RADIANS
 #include <glm/mat4x4.hpp>
@@ -52,7 +53,8 @@ struct framebuffer_base_t
      * OpenGL::render_begin() and OpenGL::render_end() */
 
     /* will invalidate texture contents if width or height changes.
-     * If tex and/or fb haven't been set, it creates them
+     * If tex and/or fb haven't been set, it takes them from the texture pool
+     * (see OpenGL::texture_pool_stats_t), or creates them.
      * Return true if texture was created/invalidated */
     bool allocate(int width, int height);
 
@@ -63,7 +65,8 @@ struct framebuffer_base_t
      * coordinate space */
     void scissor(wlr_box box) const;
 
-    /* Will destroy the texture and framebuffer
+    /* Will destroy the texture and framebuffer, or return them to the texture
+     * pool if they were allocated by allocate().
      * Warning: will destroy tex/fb even if they have been allocated outside of
      * allocate() */
     void release();
@@ -190,6 +193,51 @@ void render_end();
 /* Clear the currently bound framebuffer with the given color */
 void clear(wf::color_t color, uint32_t mask = GL_COLOR_BUFFER_BIT);
 
+/**
+ * Counters of the pool which backs wf::framebuffer_base_t::allocate().
+ *
+ * Released textures are kept in the pool, bucketed by size, and reused by the
+ * next allocation of the same size. The least recently released ones are
+ * destroyed when the idle textures exceed core/texture_pool_budget.
+ */
+struct texture_pool_stats_t
+{
+    /** Number of textures created because none of the requested size was idle */
+    uint64_t allocations = 0;
+    /** Number of allocations served by an idle texture */
+    uint64_t hits = 0;
+    /** Number of idle textures destroyed to stay within the budget */
+    uint64_t evictions = 0;
+    /** Size of all textures owned by the pool, in use or idle */
+    uint64_t resident_bytes = 0;
+    /** Size of the idle textures */
+    uint64_t idle_bytes = 0;
+};
+
+texture_pool_stats_t get_texture_pool_stats();
+
+/** Destroy all idle textures of the pool. */
+void trim_texture_pool();
+
+/**
+ * Counters of compile_program(). With core/program_cache, linked programs are
+ * stored on disk and later created from the stored binary instead of being
+ * compiled again.
+ */
+struct program_cache_stats_t
+{
+    /** Number of programs compiled from source */
+    uint64_t compiled = 0;
+    /** Time spent compiling and linking them, in microseconds */
+    uint64_t compile_us = 0;
+    /** Number of programs created from a cached binary */
+    uint64_t loaded = 0;
+    /** Time spent loading them, in microseconds */
+    uint64_t load_us = 0;
+};
+
+program_cache_stats_t get_program_cache_stats();
+
 
 enum rendering_flags_t
 {
@@ -267,6 +315,55 @@ void render_texture(wf::texture_t texture,
     glm::vec4 color = glm::vec4(1.f),
     uint32_t bits   = 0);
 
+/**
+ * Render the parts of a textured quad which intersect the given region,
+ * using the built-in shaders.
+ *
+ * In contrast to setting a scissor box for each rectangle of the region and
+ * calling render_transformed_texture() for it, each rectangle is converted to
+ * a separate quad with the corresponding texture coordinates, and all quads
+ * are drawn with a single draw call from a streamed vertex buffer.
+ *
+ * Note that this function disables the scissor test.
+ *
+ * @param texture   The texture to render.
+ * @param geometry  The initial coordinates of the quad.
+ * @param damage    The region of the quad to render, in the same coordinate
+ *                    system as @geometry.
+ * @param transform The matrix transformation to apply to the quad.
+ * @param color     A color multiplier for each channel of the texture.
+ * @param bits      A bitwise OR of texture_rendering_flags_t. In this variant,
+ *                    TEX_GEOMETRY and RENDER_FLAG_CACHED are ignored.
+ */
+void render_damaged_texture(wf::texture_t texture,
+    const wf::geometry_t& geometry,
+    const wf::region_t& damage,
+    glm::mat4 transform = glm::mat4(1.0),
+    glm::vec4 color     = glm::vec4(1.f),
+    uint32_t bits = 0);
+
+/**
+ * Render the parts of a textured quad which intersect the given region on
+ * the given framebuffer. See render_damaged_texture() above.
+ *
+ * @param texture   The texture to render.
+ * @param fb        The framebuffer to render onto.
+ *                  It should have been already bound.
+ * @param geometry  The geometry of the quad to render, in the same coordinate
+ *                    system as the framebuffer geometry.
+ * @param damage    The region of the quad to render, in the same coordinate
+ *                    system as the framebuffer geometry.
+ * @param color     A color multiplier for each channel of the texture.
+ * @param bits      A bitwise OR of texture_rendering_flags_t. In this variant,
+ *                    TEX_GEOMETRY and RENDER_FLAG_CACHED are ignored.
+ */
+void render_damaged_texture(wf::texture_t texture,
+    const wf::framebuffer_t& framebuffer,
+    const wf::geometry_t& geometry,
+    const wf::region_t& damage,
+    glm::vec4 color = glm::vec4(1.f),
+    uint32_t bits   = 0);
+
 /**
  * Render the textured rectangle again.
  *
@@ -301,6 +398,30 @@ GLuint compile_program(std::string vertex_source, std::string frag_source);
  */
 void render_rectangle(wf::geometry_t box, wf::color_t color, glm::mat4 matrix);
 
+/**
+ * A handle to a uniform of a program_t.
+ *
+ * Handles are obtained once with program_t::get_uniform(), and can then be
+ * used instead of the uniform name, so that no string lookups are needed
+ * when rendering. They remain valid if the program is recompiled.
+ *
+ * A default-constructed handle is invalid. Setting its value is an error,
+ * which is logged and otherwise ignored.
+ */
+struct uniform_handle_t
+{
+    int index = -1;
+};
+
+/**
+ * A handle to a vertex attribute of a program_t.
+ * See uniform_handle_t for details.
+ */
+struct attrib_handle_t
+{
+    int index = -1;
+};
+
 /**
  * An OpenGL program for rendering texture_t.
  * It contains multiple programs for the different texture types.
@@ -357,6 +478,38 @@ class program_t
     /** @return The program ID for the given texture type, or 0 on failure */
     int get_program_id(wf::texture_type_t type);
 
+    /**
+     * Get a handle to the uniform with the given name, which is valid for all
+     * texture types of the program.
+     * Getting the same name multiple times returns the same handle.
+     */
+    uniform_handle_t get_uniform(const std::string& name);
+
+    /**
+     * Get a handle to the vertex attribute with the given name.
+     * See get_uniform() for details.
+     */
+    attrib_handle_t get_attrib(const std::string& name);
+
+    /** Set the given uniform for the currently used program. */
+    void uniform1i(uniform_handle_t uniform, int value);
+    /** Set the given uniform for the currently used program. */
+    void uniform1f(uniform_handle_t uniform, float value);
+    /** Set the given uniform for the currently used program. */
+    void uniform2f(uniform_handle_t uniform, float x, float y);
+    /** Set the given uniform for the currently used program. */
+    void uniform3f(uniform_handle_t uniform, float x, float y, float z);
+    /** Set the given uniform for the currently used program. */
+    void uniform4f(uniform_handle_t uniform, const glm::vec4& value);
+    /** Set the given uniform for the currently used program. */
+    void uniformMatrix4f(uniform_handle_t uniform, const glm::mat4& value);
+
+    /** Same as attrib_pointer() below, but with a handle to the attribute. */
+    void attrib_pointer(attrib_handle_t attrib,
+        int size, int stride, const void *ptr, GLenum type = GL_FLOAT);
+    /** Same as attrib_divisor() below, but with a handle to the attribute. */
+    void attrib_divisor(attrib_handle_t attrib, int divisor);
+
     /** Set the given uniform for the currently used program. */
     void uniform1i(const std::string& name, int value);
     /** Set the given uniform for the currently used program. */
@@ -9,6 +9,7 @@ namespace wf
 struct framebuffer_base_t;
 struct framebuffer_t;
 struct workspace_stream_t;
+class surface_interface_t;
 /** Render hooks can be used to override Wayfire's built-in rendering. The
  * plugin which sets the hook gains full control over what and how is drawn
  * to the screen. Workspace streams however are not affected.
@@ -93,6 +94,28 @@ class render_manager : public wf::signal_provider_t
      */
     void schedule_redraw();
 
+    /**
+     * Check whether the surface was hidden at the last frame of the output,
+     * i.e fully occluded, minimized or on another workspace, while no custom
+     * renderer or workspace stream could show it. Commits of hidden surfaces
+     * do not need a repaint, because showing them damages them anyway.
+     */
+    bool is_surface_hidden(wf::surface_interface_t *surface);
+
+    /**
+     * Make sure that hidden surfaces get frame callbacks at the rate set by
+     * core/occluded_frame_rate, without repainting the output.
+     */
+    void schedule_hidden_frame_done();
+
+    /**
+     * Find again which surfaces are occluded at the next frame, because a
+     * surface changed in a way which may change it, for ex. its size or opaque
+     * region. Changes of the views, like moving or restacking them, are
+     * tracked by the render manager itself.
+     */
+    void invalidate_occlusion();
+
     /**
      * Inhibit rendering to the output. An inhibited output will show a
      * fully black image. Used mainly for compositor fade in/out on startup.
@@ -115,8 +138,13 @@ class render_manager : public wf::signal_provider_t
      * Add a new post hook.
      *
      * @param hook The hook callback
+     * @param pixel_local Whether each pixel which the hook draws depends only
+     *   on the same pixel of the source buffer, as is the case for color
+     *   effects. Then the hook is only run for the damaged part of the output,
+     *   instead of repainting the whole output each frame. Such hooks must not
+     *   change the scissor box which is set when they are called.
      */
-    void add_post(post_hook_t *hook);
+    void add_post(post_hook_t *hook, bool pixel_local = false);
 
     /**
      * Remove a post hook. No-op if hook isn't active.
@@ -193,9 +221,13 @@ class render_manager : public wf::signal_provider_t
      * This function should be called inside the rendering cycle, i.e in a
      * render or an overlay hook.
      *
+     * If the stream is displayed smaller than the output, plugins should pass
+     * the scale at which it is displayed, so that it is rendered directly at
+     * that size. Changing the scale causes a full repaint of the stream.
+     *
      * @param stream The workspace stream to update
-     * @param scale_x Unused for now
-     * @param scale_y Unused for now
+     * @param scale_x The horizontal scale of the stream relative to the output
+     * @param scale_y The vertical scale of the stream relative to the output
      */
     void workspace_stream_update(workspace_stream_t& stream,
         float scale_x = 1, float scale_y = 1);
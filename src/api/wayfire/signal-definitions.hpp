@@ -3,6 +3,8 @@
 
 #include "wayfire/view.hpp"
 #include "wayfire/output.hpp"
+#include <set>
+#include <string>
 
 /**
  * Documentation of signals emitted from core components.
@@ -144,9 +146,22 @@ struct surface_map_state_changed_signal : public wf::signal_data_t
 /**
  * name: reload-config
  * on: core
- * when: When the config file is reloaded
- * argument: unused
+ * when: When the config file is reloaded and option values changed
+ * argument: reload_config_signal, or nullptr with config backends which do not
+ *   know which options changed
+ */
+struct reload_config_signal : public wf::signal_data_t
+{
+    /** The sections in which options were added, removed or changed. */
+    std::set<std::string> changed_sections;
+};
+
+/**
+ * Check whether a reload-config signal may have changed a section. If the
+ * name ends with ':', any section with that prefix matches, for ex. "output:".
+ * Without signal data, every section may have changed.
  */
+bool config_section_changed(wf::signal_data_t *data, const std::string& section);
 
 /**
  * name: keyboard-focus-changed
@@ -634,6 +649,13 @@ struct view_change_workspace_signal : public _view_signal
  */
 using view_decoration_state_updated_signal = _view_signal;
 
+/**
+ * name: transformer-changed
+ * on: view, output(view-)
+ * when: Whenever a transformer is added to or removed from the view.
+ */
+using view_transformer_changed_signal = _view_signal;
+
 /**
  * name: decoration-changed
  * on: view
@@ -4,6 +4,9 @@
 #include <wayfire/view.hpp>
 #include <memory>
 #include <set>
+#include <map>
+#include <array>
+#include <ostream>
 
 namespace wf
 {
@@ -177,6 +180,53 @@ class transaction_t
     transaction_t() = default;
 };
 
+/**
+ * Statistics about all transactions submitted since Wayfire was started.
+ * They are meant for finding clients which stall atomic layout changes.
+ */
+struct transaction_stats_t
+{
+    /**
+     * A histogram with logarithmic buckets. Bucket 0 counts the value 0,
+     * bucket i counts the values in [2^(i-1), 2^i), and the last bucket
+     * also counts all larger values.
+     */
+    using histogram_t = std::array<uint64_t, 12>;
+
+    /** Add a value to the given histogram. */
+    static void add_sample(histogram_t& histogram, uint64_t value);
+
+    /** The number of submitted transactions. */
+    uint64_t submitted = 0;
+    /** Submitted transactions which were merged in the mega transaction. */
+    uint64_t merged = 0;
+    /** Committed transactions, including merged mega transactions. */
+    uint64_t committed = 0;
+
+    /** Transactions which became ready before the timeout. */
+    uint64_t applied   = 0;
+    uint64_t timed_out = 0;
+    uint64_t cancelled = 0;
+
+    /** Milliseconds from submitting to committing a transaction. */
+    histogram_t time_to_commit = {};
+    /** Milliseconds from committing a transaction until it is ready. */
+    histogram_t time_to_ready = {};
+    /** Number of instructions in committed transactions. */
+    histogram_t instructions = {};
+
+    /**
+     * How many timeouts each object has caused by not becoming ready.
+     * At most MAX_STALLED_OBJECTS objects are kept. When another object
+     * stalls, the object with the fewest timeouts is dropped.
+     */
+    std::map<std::string, uint64_t> stalled_objects;
+    static constexpr size_t MAX_STALLED_OBJECTS = 32;
+
+    /** Count a timeout caused by the given object. */
+    void add_stalled_object(const std::string& object);
+};
+
 /**
  * A class which holds all active (pending/committed) transactions.
  * It is responsible for merging pending transactions, committing and finalizing
@@ -209,6 +259,16 @@ class transaction_manager_t : public signal_provider_t
      */
     uint64_t submit(transaction_uptr_t tx);
 
+    /**
+     * Get the statistics about all transactions so far.
+     */
+    const transaction_stats_t& get_stats() const;
+
+    /**
+     * Print the statistics in a human-readable form, one item per line.
+     */
+    void dump_stats(std::ostream& out) const;
+
     // Implementation details
     class impl;
     std::unique_ptr<impl> priv;
@@ -19,6 +19,14 @@ enum transformer_z_order_t
     TRANSFORMER_BLUR      = 999,
 };
 
+/** The texture of one surface of a view, see render_surfaces_with_damage() */
+struct surface_texture_t
+{
+    wf::texture_t texture;
+    /** The bounding box of the surface, in output-local coordinates */
+    wlr_box box;
+};
+
 class view_transformer_t
 {
   public:
@@ -84,6 +92,27 @@ class view_transformer_t
      */
     virtual wlr_box get_bounding_box(wf::geometry_t view, wlr_box region);
 
+    /**
+     * Compute which part of the transformed view needs to be repainted when
+     * the given region of the view changes.
+     *
+     * This is used to update the intermediate buffers of a view's transformers
+     * only where they actually changed. Transformers which override this
+     * function must damage the view (see view_interface_t::damage()) whenever
+     * their parameters change, otherwise their buffer will not be updated.
+     *
+     * @param view The bounding box of the view up to this transformer, in
+     *   output-local coordinates.
+     * @param damage The damaged region before this transformer, in
+     *   output-local coordinates.
+     *
+     * @return The damaged region after this transformer, in output-local
+     *   coordinates. The default implementation returns the whole transformed
+     *   bounding box, i.e. the transformer is always fully repainted.
+     */
+    virtual wf::region_t transform_damage_region(wf::geometry_t view,
+        const wf::region_t& damage);
+
     /**
      * Render the indicated parts of the view.
      *
@@ -107,6 +136,31 @@ class view_transformer_t
         wlr_box scissor_box, const wf::framebuffer_t& target_fb)
     {}
 
+    /**
+     * Render the indicated parts of the view directly from the textures of its
+     * surfaces, instead of from a snapshot of the whole view.
+     *
+     * This is used when the transformer is the only one on a view with several
+     * surfaces, to avoid rendering the view to an offscreen buffer first.
+     * It is only possible for transformers which transform each surface
+     * independently of the others, like view_2D.
+     *
+     * @param surfaces The textures of the view's surfaces, from the bottom to
+     *   the top.
+     * @param damage The region to repaint, like in render_with_damage().
+     * @param target_fb The framebuffer to draw the view to.
+     *
+     * @return false if the surfaces were not rendered. The view is then
+     *   rendered from a snapshot with render_with_damage(). The default
+     *   implementation always returns false.
+     */
+    virtual bool render_surfaces_with_damage(
+        const std::vector<surface_texture_t>& surfaces,
+        const wf::region_t& damage, const wf::framebuffer_t& target_fb)
+    {
+        return false;
+    }
+
     view_transformer_t() = default;
     virtual ~view_transformer_t() = default;
     view_transformer_t(const view_transformer_t &) = default;
@@ -141,8 +195,24 @@ class view_2D : public view_transformer_t
         wf::geometry_t view, wf::pointf_t point) override;
     wf::pointf_t untransform_point(
         wf::geometry_t view, wf::pointf_t point) override;
+    wf::region_t transform_damage_region(wf::geometry_t view,
+        const wf::region_t& damage) override;
     void render_box(wf::texture_t src_tex, wlr_box src_box,
         wlr_box scissor_box, const wf::framebuffer_t& target_fb) override;
+
+  protected:
+    /**
+     * An implementation of render_surfaces_with_damage() which draws each
+     * surface with render_box(). Subclasses whose render_box() draws only the
+     * given texture can use it to opt into rendering the surfaces directly.
+     *
+     * It fails if the view is translucent and its surfaces overlap, because
+     * they would then be blended with each other instead of with what is
+     * below the view.
+     */
+    bool render_surfaces_with_2D_transform(
+        const std::vector<surface_texture_t>& surfaces,
+        const wf::region_t& damage, const wf::framebuffer_t& target_fb);
 };
 
 /* Those are centered relative to the view's bounding box */
@@ -170,6 +240,8 @@ class view_3D : public view_transformer_t
         wf::geometry_t view, wf::pointf_t point) override;
     wf::pointf_t untransform_point(
         wf::geometry_t view, wf::pointf_t point) override;
+    wf::region_t transform_damage_region(wf::geometry_t view,
+        const wf::region_t& damage) override;
     void render_box(wf::texture_t src_tex, wlr_box src_box,
         wlr_box scissor_box, const wf::framebuffer_t& target_fb) override;
 
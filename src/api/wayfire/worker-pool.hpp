@@ -0,0 +1,91 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace wf
+{
+/**
+ * A pool of persistent worker threads, shared by the whole compositor.
+ *
+ * It is meant for CPU-heavy work which can be split in independent parts,
+ * for ex. updating particle systems, so that plugins do not need to create
+ * their own threads. The worker threads are started on first use.
+ *
+ * The functions of the pool may be called from any thread, including from
+ * jobs which are running on the pool.
+ */
+class worker_pool_t
+{
+  public:
+    /** Get the compositor-wide worker pool. */
+    static worker_pool_t& get();
+
+    /**
+     * @return The maximal number of threads which execute the chunks of a
+     *   parallel_for(), including the calling thread.
+     */
+    int get_concurrency() const;
+
+    /**
+     * A function which processes the elements in the range [start, end).
+     * It must be safe to call it concurrently for different ranges.
+     */
+    using range_func_t = std::function<void (size_t start, size_t end)>;
+
+    /**
+     * Split the range [0, count) into chunks of at least @min_chunk elements
+     * and process them on the worker threads and on the calling thread.
+     * Returns after all chunks have been processed or skipped.
+     *
+     * @param count The number of elements to process.
+     * @param min_chunk The minimal number of elements in a chunk, so that
+     *   small amounts of work are not distributed across threads.
+     * @param func The function which processes a chunk.
+     * @param deadline A time (as returned by wf::get_current_time()) after
+     *   which no new chunks are started, for ex. the time at which the next
+     *   frame has to be ready. Chunks which were not started by then are
+     *   skipped. 0 means that there is no deadline.
+     *
+     * @return The number of elements which were processed.
+     */
+    size_t parallel_for(size_t count, size_t min_chunk, range_func_t func,
+        uint32_t deadline = 0);
+
+    /**
+     * Run the given job asynchronously on one of the worker threads.
+     *
+     * @param job The job to run. It must not use compositor state which is
+     *   not thread-safe.
+     * @param on_done If set, it is called on the compositor thread from the
+     *   main event loop after the job has finished. It can be used to pass
+     *   the results of the job back to the compositor.
+     * @param owner If set, the job can be waited for with drain(owner).
+     */
+    void submit(std::function<void()> job,
+        std::function<void()> on_done = nullptr, const void *owner = nullptr);
+
+    /**
+     * Wait for all jobs which were submitted with the given owner to finish,
+     * and call their on_done callbacks which have not been called yet.
+     * It must be called on the compositor thread.
+     *
+     * Afterwards, the pool doesn't hold any function of these jobs, so it can
+     * be used for ex. before the plugin which submitted them is unloaded.
+     */
+    void drain(const void *owner);
+
+    ~worker_pool_t();
+    worker_pool_t(const worker_pool_t &) = delete;
+    worker_pool_t(worker_pool_t &&) = delete;
+    worker_pool_t& operator =(const worker_pool_t&) = delete;
+    worker_pool_t& operator =(worker_pool_t&&) = delete;
+
+  private:
+    worker_pool_t();
+    class impl;
+    std::unique_ptr<impl> priv;
+};
+}
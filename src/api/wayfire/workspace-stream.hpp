@@ -14,6 +14,8 @@ struct workspace_stream_t
     wf::framebuffer_base_t buffer;
     bool running = false;
 
+    /* The scale the stream was last updated with. The stream's buffer has the
+     * size of the output multiplied by the larger of the two scales. */
     float scale_x = 1.0;
     float scale_y = 1.0;
 
@@ -0,0 +1,76 @@
+#include "chrome-trace.hpp"
+#include <chrono>
+
+namespace
+{
+/** Escape a string for use in a JSON document */
+std::string json_escape(const std::string& str)
+{
+    std::string result;
+    for (char c : str)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            result += '\\';
+        }
+
+        result += c;
+    }
+
+    return result;
+}
+}
+
+int64_t wf::trace_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+wf::chrome_trace_writer_t::chrome_trace_writer_t(std::ostream& out) : out(out)
+{
+    out << "{\"traceEvents\":[";
+}
+
+void wf::chrome_trace_writer_t::begin_event()
+{
+    if (!first)
+    {
+        out << ",\n";
+    }
+
+    first = false;
+}
+
+void wf::chrome_trace_writer_t::thread_name(int64_t tid, const std::string& name)
+{
+    begin_event();
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid <<
+        ",\"args\":{\"name\":\"" << json_escape(name) << "\"}}";
+}
+
+void wf::chrome_trace_writer_t::complete_event(const std::string& name,
+    const char *category, int64_t tid, int64_t start_us, int64_t duration_us,
+    int64_t frame)
+{
+    begin_event();
+    out << "{\"name\":\"" << json_escape(name) << "\"";
+    if (category)
+    {
+        out << ",\"cat\":\"" << category << "\"";
+    }
+
+    out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid;
+    out << ",\"ts\":" << start_us << ",\"dur\":" << duration_us;
+    if (frame >= 0)
+    {
+        out << ",\"args\":{\"frame\":" << frame << "}";
+    }
+
+    out << "}";
+}
+
+void wf::chrome_trace_writer_t::finish()
+{
+    out << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
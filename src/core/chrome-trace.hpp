@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace wf
+{
+/** @return The time of the steady clock in microseconds, as used in traces. */
+int64_t trace_now_us();
+
+/**
+ * Writes events in the Chrome trace format, which can be opened in
+ * chrome://tracing or Perfetto. Used by the startup and frame profilers.
+ *
+ * The document is started when the writer is created, and finished by
+ * finish().
+ */
+class chrome_trace_writer_t
+{
+  public:
+    chrome_trace_writer_t(std::ostream& out);
+
+    chrome_trace_writer_t(const chrome_trace_writer_t &) = delete;
+    chrome_trace_writer_t& operator =(const chrome_trace_writer_t&) = delete;
+
+    /** Name the track of the given thread ID. */
+    void thread_name(int64_t tid, const std::string& name);
+
+    /**
+     * Add an event which lasted for the given time.
+     *
+     * @param category The category of the event, or nullptr for none.
+     * @param frame The frame in which the event happened, shown as an
+     *   argument of the event, or -1 for none.
+     */
+    void complete_event(const std::string& name, const char *category,
+        int64_t tid, int64_t start_us, int64_t duration_us, int64_t frame = -1);
+
+    /** Finish the document. No events may be added afterwards. */
+    void finish();
+
+  private:
+    std::ostream& out;
+    bool first = true;
+
+    void begin_event();
+};
+}
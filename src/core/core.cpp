@@ -4,6 +4,7 @@
 #endif
 
 #include <sys/wait.h>
+#include <signal.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <float.h>
@@ -18,6 +19,7 @@
 
 #include "seat/keyboard.hpp"
 #include "opengl-priv.hpp"
+#include "startup-profiler.hpp"
 #include "seat/input-manager.hpp"
 #include "seat/input-method-relay.hpp"
 #include "seat/touch.hpp"
@@ -173,6 +175,12 @@ struct wlr_idle_inhibitor_t : public wf::idle_inhibitor_t
 
 void wf::compositor_core_impl_t::init()
 {
+    wf::startup_profiler_t::scope_t scope{"core-init"};
+
+    /* Keyboards are created when the backend is started, by then the keymap
+     * has been compiled in parallel with the rest of the initialization. */
+    wf::keyboard_t::prepare_keymap();
+
     wlr_renderer_init_wl_display(renderer, display);
 
     /* Order here is important:
@@ -304,8 +312,11 @@ void wf::compositor_core_impl_t::init()
     wf_shell  = wayfire_shell_create(display);
     gtk_shell = wf_gtk_shell_create(display);
 
-    image_io::init();
-    OpenGL::init();
+    {
+        wf::startup_profiler_t::scope_t gl_scope{"opengl-init"};
+        image_io::init();
+        OpenGL::init();
+    }
 
     init_last_view_tracking();
     this->state = compositor_state_t::START_BACKEND;
@@ -807,6 +818,12 @@ pid_t wf::compositor_core_impl_t::run(std::string command)
             dup2(dev_null, 2);
             close(dev_null);
 
+            /* The compositor blocks signals which it handles in the event
+             * loop, like SIGUSR1. Don't pass them blocked to the client. */
+            sigset_t set;
+            sigemptyset(&set);
+            sigprocmask(SIG_SETMASK, &set, NULL);
+
             _exit(execl("/bin/sh", "/bin/sh", "-c", command.c_str(), NULL));
         } else
         {
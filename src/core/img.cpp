@@ -1,6 +1,7 @@
 #include <wayfire/util/log.hpp>
 #include "wayfire/img.hpp"
 #include "wayfire/opengl.hpp"
+#include "wayfire/worker-pool.hpp"
 
 #include <config.h>
 
@@ -13,7 +14,11 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
 #include <cstdio>
+#include <list>
+#include <map>
 #include <unordered_map>
 #include <functional>
 
@@ -21,7 +26,7 @@
 
 namespace image_io
 {
-using Loader = std::function<bool (const char*, GLuint)>;
+using Loader = std::function<bool (const char*, image_t&)>;
 using Writer = std::function<void (const char*name, uint8_t*pixels, unsigned long,
     unsigned long)>;
 namespace
@@ -30,99 +35,148 @@ std::unordered_map<std::string, Loader> loaders;
 std::unordered_map<std::string, Writer> writers;
 }
 
-bool load_data_as_cubemap(unsigned char *data, int width, int height, int channels)
+/*
+ *  CUBEMAP IMAGE FORMAT
+ *
+ *    0    1    2    3
+ *    _____________________
+ *  0 | X  | T  | X  | X  |
+ *    |____|____|____|____|
+ *  1 | R  | F  | L  | BA |
+ *    |____|____|____|____|
+ *  2 | X  | BO | X  | X  |
+ *    |____|____|____|____|
+ *
+ *  WIDTH / 4 == HEIGHT / 3
+ *
+ *  X : UNUSED
+ *  T:  TOP
+ *  R:  RIGHT
+ *  F:  FRONT
+ *  L:  LEFT
+ *  BA: BACK
+ *  BO: BOTTOM
+ *
+ */
+static void get_cubemap_face_position(GLenum face, int& x, int& y)
 {
-    width  /= 4;
-    height /= 3;
-    int x, y, t;
-
-    if (width != height)
+    switch (face)
     {
-        LOGE("cubemap width / 4(", width, ") != height / 3(", height, ")");
-        return false;
-    }
+      case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
+        x = 2, y = 1;
+        break;
 
-    /*
-     *  CUBEMAP IMAGE FORMAT
-     *
-     *    0    1    2    3
-     *    _____________________
-     *  0 | X  | T  | X  | X  |
-     *    |____|____|____|____|
-     *  1 | R  | F  | L  | BA |
-     *    |____|____|____|____|
-     *  2 | X  | BO | X  | X  |
-     *    |____|____|____|____|
-     *
-     *  WIDTH / 4 == HEIGHT / 3
-     *
-     *  X : UNUSED
-     *  T:  TOP
-     *  R:  RIGHT
-     *  F:  FRONT
-     *  L:  LEFT
-     *  BA: BACK
-     *  BO: BOTTOM
-     *
-     */
-
-    for (t = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
-         t < GL_TEXTURE_CUBE_MAP_POSITIVE_X + 6;
-         t++)
-    {
-        switch (t)
-        {
-          case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
-            x = 2, y = 1;
-            break;
+      case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
+        x = 0, y = 1;
+        break;
 
-          case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
-            x = 0, y = 1;
-            break;
+      case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
+        x = 1, y = 0;
+        break;
 
-          case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
-            x = 1, y = 0;
-            break;
+      case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
+        x = 1, y = 2;
+        break;
 
-          case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
-            x = 1, y = 2;
-            break;
+      case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
+        x = 1, y = 1;
+        break;
 
-          case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
-            x = 1, y = 1;
-            break;
+      default: // GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
+        x = 3, y = 1;
+        break;
+    }
+}
 
-          case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
-            x = 3, y = 1;
-            break;
+texture_upload_t::texture_upload_t(std::shared_ptr<const image_t> image,
+    GLuint target, int rows_per_step)
+{
+    this->image  = image;
+    this->target = target;
+    this->rows_per_step = std::max(rows_per_step, 1);
 
-          default:
-            return false;
-            break;
+    if (target == GL_TEXTURE_CUBE_MAP)
+    {
+        nr_faces    = 6;
+        face_width  = image->width / 4;
+        face_height = image->height / 3;
+        if (face_width != face_height)
+        {
+            LOGE("cubemap width / 4(", face_width, ") != height / 3(",
+                face_height, ")");
+            valid = false;
         }
+    } else
+    {
+        nr_faces    = 1;
+        face_width  = image->width;
+        face_height = image->height;
+    }
+}
+
+bool texture_upload_t::is_valid() const
+{
+    return valid;
+}
+
+bool texture_upload_t::step()
+{
+    if (!valid || (face >= nr_faces))
+    {
+        return true;
+    }
 
-        auto format = (channels == 4 ? GL_RGBA : GL_RGB);
-        GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, width * 4));
-        GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS, y * height));
-        GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS, x * width));
+    GLenum face_target = target;
+    int x = 0, y = 0;
+    if (target == GL_TEXTURE_CUBE_MAP)
+    {
+        face_target = GL_TEXTURE_CUBE_MAP_POSITIVE_X + face;
+        get_cubemap_face_position(face_target, x, y);
+        x *= face_width;
+        y *= face_height;
+    }
 
-        GL_CALL(glTexImage2D(t, 0, format, width, height, 0,
-            format, GL_UNSIGNED_BYTE, data));
+    auto format = (image->channels == 4 ? GL_RGBA : GL_RGB);
+    if (row == 0)
+    {
+        GL_CALL(glTexImage2D(face_target, 0, format, face_width, face_height, 0,
+            format, GL_UNSIGNED_BYTE, nullptr));
     }
 
+    int nr_rows = std::min(rows_per_step, face_height - row);
+    GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, image->width));
+    GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS, y + row));
+    GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS, x));
+    GL_CALL(glTexSubImage2D(face_target, 0, 0, row, face_width, nr_rows,
+        format, GL_UNSIGNED_BYTE, image->pixels.data()));
+
+    GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
     GL_CALL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
     GL_CALL(glPixelStorei(GL_UNPACK_SKIP_ROWS, 0));
     GL_CALL(glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0));
 
-    return true;
+    row += nr_rows;
+    if (row >= face_height)
+    {
+        row = 0;
+        ++face;
+    }
+
+    return face >= nr_faces;
 }
 
 #ifdef BUILD_WITH_IMAGEIO
 /* All backend functions are taken from the internet.
  * If you want to be credited, contact me */
-bool texture_from_png(const char *filename, GLuint target)
+bool image_from_png(const char *filename, image_t& image)
 {
     FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        return false;
+    }
+
     int width, height;
     png_byte color_type;
     png_byte bit_depth;
@@ -194,36 +248,22 @@ bool texture_from_png(const char *filename, GLuint target)
 
     png_read_update_info(png, infos);
 
-    row_pointers = new png_bytep[height];
-    png_byte *data = new png_byte[height * png_get_rowbytes(png, infos)];
+    auto rowbytes = png_get_rowbytes(png, infos);
+    image.width    = width;
+    image.height   = height;
+    image.channels = png_get_channels(png, infos);
+    image.pixels.resize(height * rowbytes);
 
+    row_pointers = new png_bytep[height];
     for (int i = 0; i < height; i++)
     {
-        row_pointers[i] = data + i * png_get_rowbytes(png, infos);
+        row_pointers[i] = image.pixels.data() + i * rowbytes;
     }
 
     png_read_image(png, row_pointers);
 
-    if (target == GL_TEXTURE_CUBE_MAP)
-    {
-        if (!load_data_as_cubemap(data, width, height,
-            png_get_channels(png, infos)))
-        {
-            png_destroy_read_struct(&png, &infos, NULL);
-            delete[] row_pointers;
-            delete[] data;
-            fclose(fp);
-            return false;
-        }
-    } else if (target == GL_TEXTURE_2D)
-    {
-        GL_CALL(glTexImage2D(target, 0, GL_RGBA, width, height, 0,
-            GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid*)data));
-    }
-
     png_destroy_read_struct(&png, &infos, NULL);
     delete[] row_pointers;
-    delete[] data;
 
     fclose(fp);
 
@@ -288,11 +328,9 @@ void texture_to_png(const char *name, uint8_t *pixels, int w, int h)
     delete[] rows;
 }
 
-bool texture_from_jpeg(const char *FileName, GLuint target)
+bool image_from_jpeg(const char *FileName, image_t& image)
 {
-    unsigned long data_size;
     unsigned char *rowptr[1];
-    unsigned char *jdata;
     struct jpeg_decompress_struct infot;
     struct jpeg_error_mgr err;
 
@@ -302,8 +340,7 @@ bool texture_from_jpeg(const char *FileName, GLuint target)
 
     if (!file)
     {
-        LOGE("failed to read JPEG file ", FileName);
-
+        jpeg_destroy_decompress(&infot);
         return false;
     }
 
@@ -311,53 +348,37 @@ bool texture_from_jpeg(const char *FileName, GLuint target)
     jpeg_read_header(&infot, TRUE);
     jpeg_start_decompress(&infot);
 
-    data_size = infot.output_width * infot.output_height * 3;
-
-    jdata = new unsigned char [data_size];
+    image.width    = infot.output_width;
+    image.height   = infot.output_height;
+    image.channels = 3;
+    image.pixels.resize((size_t)image.width * image.height * 3);
     while (infot.output_scanline < infot.output_height)
     {
-        rowptr[0] = (unsigned char*)jdata + 3 * infot.output_width *
+        rowptr[0] = image.pixels.data() + 3 * infot.output_width *
             infot.output_scanline;
         jpeg_read_scanlines(&infot, rowptr, 1);
     }
 
     jpeg_finish_decompress(&infot);
-
-    GLint width  = infot.output_width;
-    GLint height = infot.output_height;
-
-    if (target == GL_TEXTURE_CUBE_MAP)
-    {
-        if (!load_data_as_cubemap(jdata, width, height, 3))
-        {
-            fclose(file);
-            delete[] jdata;
-            return false;
-        }
-    } else if (target == GL_TEXTURE_2D)
-    {
-        GL_CALL(glTexImage2D(target, 0, GL_RGB, width, height, 0,
-            GL_RGB, GL_UNSIGNED_BYTE, jdata));
-    }
-
+    jpeg_destroy_decompress(&infot);
     fclose(file);
-    delete[] jdata;
 
     return true;
 }
 
 #endif
 
-bool load_from_file(std::string name, GLuint target)
+/* Find the loader for the given file, logging an error if there is none */
+static const Loader *find_loader(const std::string& name)
 {
     if (access(name.c_str(), F_OK) == -1)
     {
         if (!name.empty())
         {
-            LOGE(__func__, "() cannot access ", name);
+            LOGE("load_from_file() cannot access ", name);
         }
 
-        return false;
+        return nullptr;
     }
 
     int len = name.length();
@@ -366,7 +387,7 @@ bool load_from_file(std::string name, GLuint target)
         LOGE(
             "load_from_file() called with file without extension or with invalid extension!");
 
-        return false;
+        return nullptr;
     }
 
     auto ext = name.substr(len - 3, 3);
@@ -380,10 +401,246 @@ bool load_from_file(std::string name, GLuint target)
     {
         LOGE("load_from_file() called with unsupported extension ", ext);
 
+        return nullptr;
+    }
+
+    return &it->second;
+}
+
+bool load_from_file(std::string name, GLuint target)
+{
+    auto loader = find_loader(name);
+    auto image  = std::make_shared<image_t>();
+    if (!loader || !(*loader)(name.c_str(), *image))
+    {
         return false;
-    } else
+    }
+
+    texture_upload_t upload{image, target, image->height};
+    while (!upload.step())
+    {}
+
+    return upload.is_valid();
+}
+
+namespace
+{
+struct cached_image_t
+{
+    std::string name;
+    int64_t mtime;
+    std::shared_ptr<const image_t> image;
+};
+
+/* The last decoded images, most recently used first */
+constexpr size_t MAX_CACHED_IMAGES = 4;
+std::list<cached_image_t> image_cache;
+
+/* Callbacks waiting for images which are being decoded, by name and mtime */
+std::map<std::pair<std::string, int64_t>,
+    std::vector<image_callback_t>> pending_images;
+}
+
+static int64_t get_mtime(const std::string& name)
+{
+    struct stat st;
+    if (stat(name.c_str(), &st) != 0)
+    {
+        return -1;
+    }
+
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+void load_async(std::string name, image_callback_t callback)
+{
+    int64_t mtime = get_mtime(name);
+    for (auto it = image_cache.begin(); it != image_cache.end(); ++it)
+    {
+        if ((it->name == name) && (it->mtime == mtime))
+        {
+            image_cache.splice(image_cache.begin(), image_cache, it);
+            callback(it->image);
+            return;
+        }
+    }
+
+    auto loader = find_loader(name);
+    if (!loader)
+    {
+        callback(nullptr);
+        return;
+    }
+
+    auto& waiting = pending_images[{name, mtime}];
+    waiting.push_back(std::move(callback));
+    if (waiting.size() > 1)
+    {
+        return;
+    }
+
+    auto image   = std::make_shared<image_t>();
+    auto success = std::make_shared<bool>(false);
+    wf::worker_pool_t::get().submit([=, decode = *loader] ()
+    {
+        *success = decode(name.c_str(), *image);
+    }, [=] ()
+    {
+        auto it = pending_images.find({name, mtime});
+        auto callbacks = std::move(it->second);
+        pending_images.erase(it);
+
+        std::shared_ptr<const image_t> result;
+        if (*success)
+        {
+            result = image;
+            image_cache.remove_if([&] (const cached_image_t& cached)
+            {
+                return cached.name == name;
+            });
+            image_cache.push_front({name, mtime, result});
+            if (image_cache.size() > MAX_CACHED_IMAGES)
+            {
+                image_cache.pop_back();
+            }
+        } else
+        {
+            LOGE("Failed to decode image ", name);
+        }
+
+        for (auto& cb : callbacks)
+        {
+            cb(result);
+        }
+    });
+}
+
+async_texture_t::async_texture_t(GLuint target)
+{
+    this->target = target;
+    this->self   = std::make_shared<async_texture_t*>(this);
+}
+
+async_texture_t::~async_texture_t()
+{
+    OpenGL::render_begin();
+    if (tex != (GLuint)-1)
+    {
+        GL_CALL(glDeleteTextures(1, &tex));
+    }
+
+    if (pending_tex != (GLuint)-1)
+    {
+        GL_CALL(glDeleteTextures(1, &pending_tex));
+    }
+
+    OpenGL::render_end();
+}
+
+void async_texture_t::load(const std::string& name, std::function<void()> on_ready)
+{
+    if (this->name == name)
+    {
+        return;
+    }
+
+    this->name = name;
+    this->on_ready = std::move(on_ready);
+    upload.reset();
+
+    std::weak_ptr<async_texture_t*> weak_self = self;
+    load_async(name, [weak_self, name] (std::shared_ptr<const image_t> image)
+    {
+        auto alive = weak_self.lock();
+        if (!alive || ((*alive)->name != name))
+        {
+            return;
+        }
+
+        auto texture = *alive;
+        if (image)
+        {
+            texture->upload =
+                std::make_unique<texture_upload_t>(image, texture->target);
+        } else
+        {
+            /* Show that the image couldn't be loaded, as load_from_file() */
+            OpenGL::render_begin();
+            if (texture->tex != (GLuint)-1)
+            {
+                GL_CALL(glDeleteTextures(1, &texture->tex));
+                texture->tex = -1;
+            }
+
+            OpenGL::render_end();
+        }
+
+        auto on_ready = std::move(texture->on_ready);
+        texture->on_ready = nullptr;
+        if (on_ready)
+        {
+            on_ready();
+        }
+    });
+}
+
+bool async_texture_t::update()
+{
+    if (!upload)
+    {
+        return false;
+    }
+
+    if (pending_tex == (GLuint)-1)
+    {
+        GL_CALL(glGenTextures(1, &pending_tex));
+    }
+
+    GL_CALL(glBindTexture(target, pending_tex));
+    bool done = upload->step();
+    if (done)
+    {
+        if (upload->is_valid())
+        {
+            apply_parameters();
+            if (tex != (GLuint)-1)
+            {
+                GL_CALL(glDeleteTextures(1, &tex));
+            }
+
+            tex = pending_tex;
+        } else
+        {
+            GL_CALL(glDeleteTextures(1, &pending_tex));
+            if (tex != (GLuint)-1)
+            {
+                GL_CALL(glDeleteTextures(1, &tex));
+                tex = -1;
+            }
+        }
+
+        pending_tex = -1;
+        upload.reset();
+    }
+
+    GL_CALL(glBindTexture(target, 0));
+    return !done;
+}
+
+GLuint async_texture_t::get_texture() const
+{
+    return tex;
+}
+
+void async_texture_t::apply_parameters()
+{
+    GL_CALL(glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CALL(glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CALL(glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CALL(glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    if (target == GL_TEXTURE_CUBE_MAP)
     {
-        return it->second(name.c_str(), target);
+        GL_CALL(glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
     }
 }
 
@@ -404,8 +661,8 @@ void init()
 {
     LOGD("init ImageIO");
 #ifdef BUILD_WITH_IMAGEIO
-    loaders["png"] = Loader(texture_from_png);
-    loaders["jpg"] = Loader(texture_from_jpeg);
+    loaders["png"] = Loader(image_from_png);
+    loaders["jpg"] = Loader(image_from_jpeg);
     writers["png"] = Writer(texture_to_png);
 #endif
 }
@@ -2,26 +2,54 @@
 #include "wayfire/nonstd/safe-list.hpp"
 #include <unordered_map>
 #include <set>
+#include <cstdint>
 
 /* Implementation note: because of circular dependencies between
  * signal_connection_t and signal_provider_t, the chosen way to resolve
  * them is to have signal_provider_t directly modify signal_connection_t
  * private data when needed. */
 
+namespace
+{
+/** All signal names which have been interned so far */
+std::unordered_map<std::string, wf::signal_id_t>& get_signal_ids()
+{
+    static std::unordered_map<std::string, wf::signal_id_t> ids;
+    return ids;
+}
+}
+
+wf::signal_id_t wf::get_signal_id(const std::string& name)
+{
+    auto& ids = get_signal_ids();
+    auto it   = ids.find(name);
+    if (it != ids.end())
+    {
+        return it->second;
+    }
+
+    wf::signal_id_t id = ids.size();
+    ids.emplace(name, id);
+    return id;
+}
+
 class wf::signal_connection_t::impl
 {
   public:
     signal_callback_t callback;
-    std::set<nonstd::observer_ptr<signal_provider_t>> connected_providers;
+    /* The providers this connection is connected to, and to which signals */
+    std::set<std::pair<signal_provider_t*, signal_id_t>> connected;
 
-    void add(signal_provider_t *provider)
+    void add(signal_provider_t *provider, signal_id_t id)
     {
-        connected_providers.insert(provider);
+        connected.insert({provider, id});
     }
 
+    /** Forget all connections to the given provider */
     void remove(signal_provider_t *provider)
     {
-        connected_providers.erase(provider);
+        connected.erase(connected.lower_bound({provider, 0}),
+            connected.upper_bound({provider, UINT32_MAX}));
     }
 };
 
@@ -50,17 +78,16 @@ void wf::signal_connection_t::emit(signal_data_t *data)
 
 void wf::signal_connection_t::disconnect()
 {
-    auto connected = this->priv->connected_providers;
-    for (auto& provider : connected)
+    while (!priv->connected.empty())
     {
-        provider->disconnect_signal(this);
+        priv->connected.begin()->first->disconnect_signal(this);
     }
 }
 
 class wf::signal_provider_t::sprovider_impl
 {
   public:
-    std::unordered_map<std::string,
+    std::unordered_map<wf::signal_id_t,
         wf::safe_list_t<signal_connection_t*>> signals;
 };
 
@@ -80,35 +107,65 @@ wf::signal_provider_t::~signal_provider_t()
     }
 }
 
-void wf::signal_provider_t::connect_signal(std::string name,
+void wf::signal_provider_t::connect_signal(const std::string& name,
+    signal_connection_t *callback)
+{
+    connect_signal(get_signal_id(name), callback);
+}
+
+void wf::signal_provider_t::connect_signal(signal_id_t id,
     signal_connection_t *callback)
 {
-    sprovider_priv->signals[name].push_back(callback);
-    callback->priv->add(this);
+    sprovider_priv->signals[id].push_back(callback);
+    callback->priv->add(this, id);
 }
 
 void wf::signal_provider_t::disconnect_signal(signal_connection_t *connection)
 {
-    for (auto& s : sprovider_priv->signals)
+    auto& connected = connection->priv->connected;
+    auto begin = connected.lower_bound({this, 0});
+    auto end   = connected.upper_bound({this, UINT32_MAX});
+
+    /* Only visit the signals the connection is actually connected to */
+    for (auto it = begin; it != end; ++it)
     {
-        s.second.remove_if([=] (signal_connection_t *connected)
+        auto list = sprovider_priv->signals.find(it->second);
+        if (list == sprovider_priv->signals.end())
         {
-            if (connected == connection)
-            {
-                connected->priv->remove(this);
-
-                return true;
-            }
+            continue;
+        }
 
-            return false;
+        list->second.remove_if([=] (signal_connection_t *connected)
+        {
+            return connected == connection;
         });
     }
+
+    connected.erase(begin, end);
 }
 
 /* Emit the given signal. No type checking for data is required */
-void wf::signal_provider_t::emit_signal(std::string name, wf::signal_data_t *data)
+void wf::signal_provider_t::emit_signal(const std::string& name,
+    wf::signal_data_t *data)
+{
+    /* Don't intern names nobody has connected to */
+    auto& ids = get_signal_ids();
+    auto it   = ids.find(name);
+    if (it != ids.end())
+    {
+        emit_signal(it->second, data);
+    }
+}
+
+void wf::signal_provider_t::emit_signal(signal_id_t id, wf::signal_data_t *data)
 {
-    sprovider_priv->signals[name].for_each([data] (auto call)
+    auto it = sprovider_priv->signals.find(id);
+    if (it == sprovider_priv->signals.end())
+    {
+        return;
+    }
+
+    it->second.for_each([data] (auto call)
     {
         call->emit(data);
     });
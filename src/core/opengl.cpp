@@ -1,6 +1,14 @@
 #include <wayfire/util/log.hpp>
 #include <map>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <wayfire/option-wrapper.hpp>
 #include "opengl-priv.hpp"
+#include "program-cache.hpp"
 #include "wayfire/output.hpp"
 #include "core-impl.hpp"
 #include "config.h"
@@ -43,6 +51,194 @@ void gl_call(const char *func, uint32_t line, const char *glfunc)
         gl_error_string(glGetError()));
 }
 
+static std::string framebuffer_status_to_str(
+    GLuint status)
+{
+    switch (status)
+    {
+      case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
+        return "incomplete attachment";
+
+      case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
+        return "missing attachment";
+
+      case GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS:
+        return "incomplete dimensions";
+
+      case GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE:
+        return "incomplete multisample";
+
+      default:
+        return "unknown";
+    }
+}
+
+namespace OpenGL
+{
+namespace
+{
+/**
+ * Keeps the textures and framebuffers released by wf::framebuffer_base_t, so
+ * that resizing views and starting workspace streams mostly reuses existing
+ * textures instead of reallocating them.
+ *
+ * Idle textures are bucketed by their exact size: framebuffers are sampled as
+ * a whole with [0,1] texture coordinates, so a larger texture can't be used in
+ * place of a smaller one.
+ */
+class texture_pool_t
+{
+  public:
+    texture_pool_t()
+    {
+        budget.load_option("core/texture_pool_budget");
+    }
+
+    ~texture_pool_t()
+    {
+        trim(0);
+    }
+
+    /**
+     * Take an idle texture of the given size, or create a new one.
+     *
+     * @return false if the framebuffer could not be created.
+     */
+    bool acquire(int32_t width, int32_t height, GLuint& tex, GLuint& fb)
+    {
+        auto bucket = buckets.find(size_key(width, height));
+        if (bucket != buckets.end())
+        {
+            auto it = bucket->second.back();
+            bucket->second.pop_back();
+            if (bucket->second.empty())
+            {
+                buckets.erase(bucket);
+            }
+
+            entry_t entry = *it;
+            idle.erase(it);
+
+            stats.hits++;
+            stats.idle_bytes -= entry.size();
+            tex = entry.tex;
+            fb  = entry.fb;
+            lent[tex] = entry;
+            return true;
+        }
+
+        entry_t entry{0, 0, width, height};
+        GL_CALL(glGenTextures(1, &entry.tex));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, entry.tex));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
+            0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+
+        GL_CALL(glGenFramebuffers(1, &entry.fb));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, entry.fb));
+        GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, entry.tex, 0));
+
+        auto status = GL_CALL(glCheckFramebufferStatus(GL_FRAMEBUFFER));
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            LOGE("Failed to initialize framebuffer: ",
+                framebuffer_status_to_str(status));
+            GL_CALL(glDeleteFramebuffers(1, &entry.fb));
+            GL_CALL(glDeleteTextures(1, &entry.tex));
+            return false;
+        }
+
+        stats.allocations++;
+        stats.resident_bytes += entry.size();
+        tex = entry.tex;
+        fb  = entry.fb;
+        lent[tex] = entry;
+        return true;
+    }
+
+    /** Whether the given texture and framebuffer were lent by the pool. */
+    bool owns(GLuint tex, GLuint fb) const
+    {
+        auto it = lent.find(tex);
+        return (it != lent.end()) && (it->second.fb == fb);
+    }
+
+    /** Return a texture lent by acquire() to the pool. */
+    void release(GLuint tex)
+    {
+        auto it = lent.find(tex);
+        entry_t entry = it->second;
+        lent.erase(it);
+
+        idle.push_front(entry);
+        buckets[size_key(entry.width, entry.height)].push_back(idle.begin());
+        stats.idle_bytes += entry.size();
+        trim(uint64_t(std::max(0, (int)budget)) << 20);
+    }
+
+    /** Destroy the least recently released textures until at most @limit bytes
+     * are idle. */
+    void trim(uint64_t limit)
+    {
+        while ((stats.idle_bytes > limit) && !idle.empty())
+        {
+            auto it     = std::prev(idle.end());
+            auto bucket = buckets.find(size_key(it->width, it->height));
+            auto& list  = bucket->second;
+            list.erase(std::find(list.begin(), list.end(), it));
+            if (list.empty())
+            {
+                buckets.erase(bucket);
+            }
+
+            GL_CALL(glDeleteFramebuffers(1, &it->fb));
+            GL_CALL(glDeleteTextures(1, &it->tex));
+            stats.evictions++;
+            stats.idle_bytes     -= it->size();
+            stats.resident_bytes -= it->size();
+            idle.erase(it);
+        }
+    }
+
+    texture_pool_stats_t stats;
+
+  private:
+    wf::option_wrapper_t<int> budget;
+
+    struct entry_t
+    {
+        GLuint tex, fb;
+        int32_t width, height;
+
+        uint64_t size() const
+        {
+            return uint64_t(width) * height * 4;
+        }
+    };
+
+    static uint64_t size_key(int32_t width, int32_t height)
+    {
+        return (uint64_t(uint32_t(width)) << 32) | uint32_t(height);
+    }
+
+    /* Idle textures, most recently released first */
+    std::list<entry_t> idle;
+    /* Idle textures of each size, most recently released last */
+    std::unordered_map<uint64_t,
+        std::vector<std::list<entry_t>::iterator>> buckets;
+    /* Textures in use, by texture id */
+    std::unordered_map<GLuint, entry_t> lent;
+};
+
+std::unique_ptr<texture_pool_t> texture_pool;
+}
+}
+
+
 namespace OpenGL
 {
 /*
@@ -50,6 +246,19 @@ namespace OpenGL
  * Each of the following functions uses the currently bound context
  */
 program_t program, color_program;
+
+/* Handles to the uniforms and attributes of the builtin programs */
+attrib_handle_t program_position, program_uv, color_program_position;
+uniform_handle_t program_mvp, program_color, color_program_mvp,
+    color_program_color;
+
+/* Vertex buffer used to stream the quads of render_damaged_texture() */
+GLuint batch_vbo = 0;
+/* Size of the data store of batch_vbo, in bytes */
+GLsizeiptr batch_vbo_capacity = 0;
+/* Interleaved position and uv coordinates of the quads to draw */
+std::vector<GLfloat> batch_data;
+
 GLuint compile_shader(std::string source, GLuint type)
 {
     GLuint shader = GL_CALL(glCreateShader(type));
@@ -75,9 +284,29 @@ GLuint compile_shader(std::string source, GLuint type)
     return shader;
 }
 
+std::unique_ptr<program_cache_t> program_cache;
+program_cache_stats_t program_stats;
+
+static uint64_t elapsed_us(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
 /* Create a very simple gl program from the given shader sources */
 GLuint compile_program(std::string vertex_source, std::string frag_source)
 {
+    auto start = std::chrono::steady_clock::now();
+    if (program_cache)
+    {
+        if (auto cached = program_cache->load(vertex_source, frag_source))
+        {
+            program_stats.loaded++;
+            program_stats.load_us += elapsed_us(start);
+            return cached;
+        }
+    }
+
     auto vertex_shader   = compile_shader(vertex_source, GL_VERTEX_SHADER);
     auto fragment_shader = compile_shader(frag_source, GL_FRAGMENT_SHADER);
     auto result_program  = GL_CALL(glCreateProgram());
@@ -89,6 +318,16 @@ GLuint compile_program(std::string vertex_source, std::string frag_source)
     GL_CALL(glDeleteShader(vertex_shader));
     GL_CALL(glDeleteShader(fragment_shader));
 
+    program_stats.compiled++;
+    program_stats.compile_us += elapsed_us(start);
+
+    GLint status = GL_FALSE;
+    GL_CALL(glGetProgramiv(result_program, GL_LINK_STATUS, &status));
+    if (program_cache && (status == GL_TRUE))
+    {
+        program_cache->store(vertex_source, frag_source, result_program);
+    }
+
     return result_program;
 }
 
@@ -96,12 +335,30 @@ void init()
 {
     render_begin();
     // enable_gl_synchronuous_debug()
+    wf::option_wrapper_t<bool> use_program_cache{"core/program_cache"};
+    if (use_program_cache)
+    {
+        program_cache = std::make_unique<program_cache_t>();
+    }
+
     program.compile(default_vertex_shader_source,
         default_fragment_shader_source);
 
     color_program.set_simple(compile_program(default_vertex_shader_source,
         color_rect_fragment_source));
 
+    program_position = program.get_attrib("position");
+    program_uv    = program.get_attrib("uvPosition");
+    program_mvp   = program.get_uniform("MVP");
+    program_color = program.get_uniform("color");
+
+    color_program_position = color_program.get_attrib("position");
+    color_program_mvp   = color_program.get_uniform("MVP");
+    color_program_color = color_program.get_uniform("color");
+
+    GL_CALL(glGenBuffers(1, &batch_vbo));
+    texture_pool = std::make_unique<texture_pool_t>();
+
     render_end();
 }
 
@@ -110,6 +367,10 @@ void fini()
     render_begin();
     program.free_resources();
     color_program.free_resources();
+    GL_CALL(glDeleteBuffers(1, &batch_vbo));
+    batch_vbo = 0;
+    texture_pool.reset();
+    program_cache.reset();
     render_end();
 }
 
@@ -131,6 +392,24 @@ void unbind_output(wf::output_t *output)
     current_output_fb = 0;
 }
 
+texture_pool_stats_t get_texture_pool_stats()
+{
+    return texture_pool ? texture_pool->stats : texture_pool_stats_t{};
+}
+
+program_cache_stats_t get_program_cache_stats()
+{
+    return program_stats;
+}
+
+void trim_texture_pool()
+{
+    if (texture_pool)
+    {
+        texture_pool->trim(0);
+    }
+}
+
 std::vector<GLfloat> vertexData;
 std::vector<GLfloat> coordData;
 
@@ -173,10 +452,10 @@ void render_transformed_texture(wf::texture_t tex,
     };
 
     program.set_active_texture(tex);
-    program.attrib_pointer("position", 2, 0, vertexData.data());
-    program.attrib_pointer("uvPosition", 2, 0, coordData.data());
-    program.uniformMatrix4f("MVP", model);
-    program.uniform4f("color", color);
+    program.attrib_pointer(program_position, 2, 0, vertexData.data());
+    program.attrib_pointer(program_uv, 2, 0, coordData.data());
+    program.uniformMatrix4f(program_mvp, model);
+    program.uniform4f(program_color, color);
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -223,6 +502,89 @@ void render_texture(wf::texture_t texture,
         framebuffer.get_orthographic_projection(), color, bits);
 }
 
+void render_damaged_texture(wf::texture_t texture,
+    const wf::geometry_t& geometry, const wf::region_t& damage,
+    glm::mat4 transform, glm::vec4 color, uint32_t bits)
+{
+    if ((geometry.width <= 0) || (geometry.height <= 0))
+    {
+        return;
+    }
+
+    batch_data.clear();
+    for (const auto& rect : damage & geometry)
+    {
+        float x1 = rect.x1, y1 = rect.y1, x2 = rect.x2, y2 = rect.y2;
+
+        /* The top edge of the quad corresponds to v=1, see
+         * render_transformed_texture() */
+        float u1 = (x1 - geometry.x) / geometry.width;
+        float u2 = (x2 - geometry.x) / geometry.width;
+        float v1 = 1.0 - (y1 - geometry.y) / geometry.height;
+        float v2 = 1.0 - (y2 - geometry.y) / geometry.height;
+
+        if (bits & TEXTURE_TRANSFORM_INVERT_X)
+        {
+            u1 = 1.0 - u1;
+            u2 = 1.0 - u2;
+        }
+
+        if (bits & TEXTURE_TRANSFORM_INVERT_Y)
+        {
+            v1 = 1.0 - v1;
+            v2 = 1.0 - v2;
+        }
+
+        batch_data.insert(batch_data.end(), {
+            x1, y1, u1, v1,
+            x2, y1, u2, v1,
+            x2, y2, u2, v2,
+            x1, y1, u1, v1,
+            x2, y2, u2, v2,
+            x1, y2, u1, v2,
+        });
+    }
+
+    if (batch_data.empty())
+    {
+        return;
+    }
+
+    /* Orphan the previous contents of the buffer, so that we do not have to
+     * wait for the previous draw call to finish */
+    const GLsizeiptr size = batch_data.size() * sizeof(GLfloat);
+    batch_vbo_capacity = std::max(batch_vbo_capacity, size);
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, batch_vbo));
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, batch_vbo_capacity, NULL,
+        GL_STREAM_DRAW));
+    GL_CALL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, batch_data.data()));
+
+    program.use(texture.type);
+    program.set_active_texture(texture);
+    program.attrib_pointer(program_position, 2, 4 * sizeof(GLfloat), (void*)0);
+    program.attrib_pointer(program_uv, 2, 4 * sizeof(GLfloat),
+        (void*)(2 * sizeof(GLfloat)));
+    program.uniformMatrix4f(program_mvp, transform);
+    program.uniform4f(program_color, color);
+
+    GL_CALL(glDisable(GL_SCISSOR_TEST));
+    GL_CALL(glEnable(GL_BLEND));
+    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+    GL_CALL(glDrawArrays(GL_TRIANGLES, 0, batch_data.size() / 4));
+
+    /* The other rendering functions use client-side vertex arrays */
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    program.deactivate();
+}
+
+void render_damaged_texture(wf::texture_t texture,
+    const wf::framebuffer_t& framebuffer, const wf::geometry_t& geometry,
+    const wf::region_t& damage, glm::vec4 color, uint32_t bits)
+{
+    render_damaged_texture(texture, geometry, damage,
+        framebuffer.get_orthographic_projection(), color, bits);
+}
+
 void render_rectangle(wf::geometry_t geometry, wf::color_t color,
     glm::mat4 matrix)
 {
@@ -237,9 +599,10 @@ void render_rectangle(wf::geometry_t geometry, wf::color_t color,
         x, y,
     };
 
-    color_program.attrib_pointer("position", 2, 0, vertexData);
-    color_program.uniformMatrix4f("MVP", matrix);
-    color_program.uniform4f("color", {color.r, color.g, color.b, color.a});
+    color_program.attrib_pointer(color_program_position, 2, 0, vertexData);
+    color_program.uniformMatrix4f(color_program_mvp, matrix);
+    color_program.uniform4f(color_program_color,
+        {color.r, color.g, color.b, color.a});
 
     GL_CALL(glEnable(GL_BLEND));
     GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
@@ -286,30 +649,39 @@ void render_end()
 }
 }
 
-static std::string framebuffer_status_to_str(
-    GLuint status)
+
+bool wf::framebuffer_base_t::allocate(int width, int height)
 {
-    switch (status)
+    auto& pool = OpenGL::texture_pool;
+    bool is_empty = (fb == (uint32_t)-1) && (tex == (uint32_t)-1);
+    if (pool && (is_empty || pool->owns(tex, fb)))
     {
-      case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT:
-        return "incomplete attachment";
-
-      case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT:
-        return "missing attachment";
+        if (!is_empty && (width == viewport_width) && (height == viewport_height))
+        {
+            return false;
+        }
 
-      case GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS:
-        return "incomplete dimensions";
+        GLuint new_tex, new_fb;
+        bool success = pool->acquire(width, height, new_tex, new_fb);
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, OpenGL::current_output_fb));
+        if (!success)
+        {
+            return false;
+        }
 
-      case GL_FRAMEBUFFER_INCOMPLETE_MULTISAMPLE:
-        return "incomplete multisample";
+        if (!is_empty)
+        {
+            pool->release(tex);
+        }
 
-      default:
-        return "unknown";
+        tex = new_tex;
+        fb  = new_fb;
+        viewport_width  = width;
+        viewport_height = height;
+        return true;
     }
-}
 
-bool wf::framebuffer_base_t::allocate(int width, int height)
-{
     bool first_allocate = false;
     if (fb == (uint32_t)-1)
     {
@@ -414,6 +786,13 @@ void wf::framebuffer_base_t::scissor(wlr_box box) const
 
 void wf::framebuffer_base_t::release()
 {
+    if (OpenGL::texture_pool && OpenGL::texture_pool->owns(tex, fb))
+    {
+        OpenGL::texture_pool->release(tex);
+        reset();
+        return;
+    }
+
     if ((fb != uint32_t(-1)) && (fb != 0))
     {
         GL_CALL(glDeleteFramebuffers(1, &fb));
@@ -574,8 +953,18 @@ namespace OpenGL
 class program_t::impl
 {
   public:
-    std::set<int> active_attrs;
-    std::set<int> active_attrs_divisors;
+    /* Vectors keep their capacity when cleared, so marking attributes as
+     * active does not allocate once the program has been used. */
+    std::vector<int> active_attrs;
+    std::vector<int> active_attrs_divisors;
+
+    static void mark_active(std::vector<int>& locs, int loc)
+    {
+        if (std::find(locs.begin(), locs.end(), loc) == locs.end())
+        {
+            locs.push_back(loc);
+        }
+    }
 
     int active_program_idx = 0;
 
@@ -612,6 +1001,85 @@ class program_t::impl
 
         return attribs[active_program_idx][name];
     }
+
+    /** A uniform or attribute handed out as uniform/attrib_handle_t */
+    struct handle_data_t
+    {
+        std::string name;
+        int loc[wf::TEXTURE_TYPE_ALL];
+    };
+
+    std::vector<handle_data_t> uniform_handles;
+    std::vector<handle_data_t> attrib_handles;
+
+    /** The uniforms used by set_active_texture() */
+    uniform_handle_t uv_base, uv_scale;
+
+    void resolve_uniform(handle_data_t& handle)
+    {
+        for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
+        {
+            handle.loc[i] = id[i] ?
+                GL_CALL(glGetUniformLocation(id[i], handle.name.c_str())) : -1;
+        }
+    }
+
+    void resolve_attrib(handle_data_t& handle)
+    {
+        for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
+        {
+            handle.loc[i] = id[i] ?
+                GL_CALL(glGetAttribLocation(id[i], handle.name.c_str())) : -1;
+        }
+    }
+
+    /** Update the locations of all handles after the programs have changed */
+    void resolve_handles()
+    {
+        for (int i = 0; i < wf::TEXTURE_TYPE_ALL; i++)
+        {
+            uniforms[i].clear();
+            attribs[i].clear();
+        }
+
+        for (auto& handle : uniform_handles)
+        {
+            resolve_uniform(handle);
+        }
+
+        for (auto& handle : attrib_handles)
+        {
+            resolve_attrib(handle);
+        }
+    }
+
+    /**
+     * @return The location of the uniform in the bound program, or -1 for
+     *   handles which were not obtained from this program. GL ignores values
+     *   set for location -1.
+     */
+    int uniform_loc(uniform_handle_t uniform)
+    {
+        if ((uniform.index < 0) || (uniform.index >= (int)uniform_handles.size()))
+        {
+            LOGE("Invalid uniform handle ", uniform.index);
+            return -1;
+        }
+
+        return uniform_handles[uniform.index].loc[active_program_idx];
+    }
+
+    /** @return The location of the attribute, or -1 like uniform_loc(). */
+    int attrib_loc(attrib_handle_t attrib)
+    {
+        if ((attrib.index < 0) || (attrib.index >= (int)attrib_handles.size()))
+        {
+            LOGE("Invalid attribute handle ", attrib.index);
+            return -1;
+        }
+
+        return attrib_handles[attrib.index].loc[active_program_idx];
+    }
 };
 
 program_t::program_t()
@@ -621,6 +1089,9 @@ program_t::program_t()
     {
         this->priv->id[i] = 0;
     }
+
+    this->priv->uv_base  = get_uniform("_wayfire_uv_base");
+    this->priv->uv_scale = get_uniform("_wayfire_uv_scale");
 }
 
 void program_t::set_simple(GLuint program_id, wf::texture_type_t type)
@@ -628,6 +1099,7 @@ void program_t::set_simple(GLuint program_id, wf::texture_type_t type)
     free_resources();
     assert(type < wf::TEXTURE_TYPE_ALL);
     this->priv->id[type] = program_id;
+    this->priv->resolve_handles();
 }
 
 program_t::~program_t()
@@ -674,6 +1146,8 @@ void program_t::compile(const std::string& vertex_source,
         this->priv->id[program_type.first] =
             compile_program(vertex_source, fragment);
     }
+
+    this->priv->resolve_handles();
 }
 
 void program_t::free_resources()
@@ -705,6 +1179,99 @@ int program_t::get_program_id(wf::texture_type_t type)
     return priv->id[type];
 }
 
+uniform_handle_t program_t::get_uniform(const std::string& name)
+{
+    auto& handles = priv->uniform_handles;
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        if (handles[i].name == name)
+        {
+            return {(int)i};
+        }
+    }
+
+    handles.push_back({name, {}});
+    priv->resolve_uniform(handles.back());
+
+    return {(int)handles.size() - 1};
+}
+
+attrib_handle_t program_t::get_attrib(const std::string& name)
+{
+    auto& handles = priv->attrib_handles;
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        if (handles[i].name == name)
+        {
+            return {(int)i};
+        }
+    }
+
+    handles.push_back({name, {}});
+    priv->resolve_attrib(handles.back());
+
+    return {(int)handles.size() - 1};
+}
+
+void program_t::uniform1i(uniform_handle_t uniform, int value)
+{
+    GL_CALL(glUniform1i(priv->uniform_loc(uniform), value));
+}
+
+void program_t::uniform1f(uniform_handle_t uniform, float value)
+{
+    GL_CALL(glUniform1f(priv->uniform_loc(uniform), value));
+}
+
+void program_t::uniform2f(uniform_handle_t uniform, float x, float y)
+{
+    GL_CALL(glUniform2f(priv->uniform_loc(uniform), x, y));
+}
+
+void program_t::uniform3f(uniform_handle_t uniform, float x, float y, float z)
+{
+    GL_CALL(glUniform3f(priv->uniform_loc(uniform), x, y, z));
+}
+
+void program_t::uniform4f(uniform_handle_t uniform, const glm::vec4& value)
+{
+    GL_CALL(glUniform4f(priv->uniform_loc(uniform),
+        value.r, value.g, value.b, value.a));
+}
+
+void program_t::uniformMatrix4f(uniform_handle_t uniform, const glm::mat4& value)
+{
+    GL_CALL(glUniformMatrix4fv(priv->uniform_loc(uniform),
+        1, GL_FALSE, &value[0][0]));
+}
+
+void program_t::attrib_pointer(attrib_handle_t attrib,
+    int size, int stride, const void *ptr, GLenum type)
+{
+    int loc = priv->attrib_loc(attrib);
+    if (loc < 0)
+    {
+        return;
+    }
+
+    impl::mark_active(priv->active_attrs, loc);
+
+    GL_CALL(glEnableVertexAttribArray(loc));
+    GL_CALL(glVertexAttribPointer(loc, size, type, GL_FALSE, stride, ptr));
+}
+
+void program_t::attrib_divisor(attrib_handle_t attrib, int divisor)
+{
+    int loc = priv->attrib_loc(attrib);
+    if (loc < 0)
+    {
+        return;
+    }
+
+    impl::mark_active(priv->active_attrs_divisors, loc);
+    GL_CALL(glVertexAttribDivisor(loc, divisor));
+}
+
 void program_t::uniform1i(const std::string& name, int value)
 {
     int loc = priv->find_uniform_loc(name);
@@ -745,7 +1312,7 @@ void program_t::attrib_pointer(const std::string& attrib,
     int size, int stride, const void *ptr, GLenum type)
 {
     int loc = priv->find_attrib_loc(attrib);
-    priv->active_attrs.insert(loc);
+    impl::mark_active(priv->active_attrs, loc);
 
     GL_CALL(glEnableVertexAttribArray(loc));
     GL_CALL(glVertexAttribPointer(loc, size, type, GL_FALSE, stride, ptr));
@@ -754,7 +1321,7 @@ void program_t::attrib_pointer(const std::string& attrib,
 void program_t::attrib_divisor(const std::string& attrib, int divisor)
 {
     int loc = priv->find_attrib_loc(attrib);
-    priv->active_attrs_divisors.insert(loc);
+    impl::mark_active(priv->active_attrs_divisors, loc);
     GL_CALL(glVertexAttribDivisor(loc, divisor));
 }
 
@@ -781,8 +1348,8 @@ void program_t::set_active_texture(const wf::texture_t& texture)
         base.y   = 1.0 - base.y;
     }
 
-    uniform2f("_wayfire_uv_base", base.x, base.y);
-    uniform2f("_wayfire_uv_scale", scale.x, scale.y);
+    uniform2f(priv->uv_base, base.x, base.y);
+    uniform2f(priv->uv_scale, scale.x, scale.y);
 }
 
 void program_t::deactivate()
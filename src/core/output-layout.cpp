@@ -950,7 +950,14 @@ class output_layout_t::impl
 
         output_layout = wlr_output_layout_create();
 
-        on_config_reload.set_callback([=] (void*) { reconfigure_from_config(); });
+        on_config_reload.set_callback([=] (wf::signal_data_t *data)
+        {
+            if (config_section_changed(data, "output") ||
+                config_section_changed(data, "output:"))
+            {
+                reconfigure_from_config();
+            }
+        });
         get_core().connect_signal("reload-config", &on_config_reload);
 
         noop_backend = wlr_headless_backend_create(get_core().display);
@@ -86,6 +86,24 @@ wf::output_t *get_signaled_output(wf::signal_data_t *data)
     return result ? result->output : nullptr;
 }
 
+bool config_section_changed(wf::signal_data_t *data, const std::string& section)
+{
+    auto ev = static_cast<wf::reload_config_signal*>(data);
+    if (!ev)
+    {
+        return true;
+    }
+
+    if (section.empty() || (section.back() != ':'))
+    {
+        return ev->changed_sections.count(section);
+    }
+
+    auto it = ev->changed_sections.lower_bound(section);
+    return (it != ev->changed_sections.end()) &&
+           (it->compare(0, section.size(), section) == 0);
+}
+
 /** Implementation of default config backend functions. */
 std::shared_ptr<config::section_t> wf::config_backend_t::get_output_section(
     wlr_output *output)
@@ -0,0 +1,196 @@
+#include "program-cache.hpp"
+#include <wayfire/util/log.hpp>
+#include <wayfire/worker-pool.hpp>
+
+#include <GLES2/gl2ext.h>
+#include <EGL/egl.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+PFNGLGETPROGRAMBINARYOESPROC get_program_binary;
+PFNGLPROGRAMBINARYOESPROC program_binary;
+
+/* Bumped when the layout of the cache files changes */
+constexpr uint32_t CACHE_MAGIC = 0x31425057; // "WPB1"
+
+struct cache_header_t
+{
+    uint32_t magic;
+    uint32_t format;
+};
+
+/* FNV-1a, which unlike std::hash is the same across builds */
+uint64_t hash_string(uint64_t hash, const std::string& str)
+{
+    for (unsigned char c : str)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3;
+    }
+
+    /* Separate consecutive strings */
+    hash ^= 0xff;
+    hash *= 0x100000001b3;
+    return hash;
+}
+
+std::string get_gl_string(GLenum name)
+{
+    auto str = (const char*)glGetString(name);
+    return str ? str : "";
+}
+
+bool make_directory(const std::string& path)
+{
+    return (mkdir(path.c_str(), 0700) == 0) || (errno == EEXIST);
+}
+}
+
+OpenGL::program_cache_t::program_cache_t()
+{
+    auto extensions = get_gl_string(GL_EXTENSIONS);
+    if (extensions.find("GL_OES_get_program_binary") == std::string::npos)
+    {
+        LOGI("GL program binaries are not supported, programs are not cached");
+        return;
+    }
+
+    GLint nr_formats = 0;
+    GL_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &nr_formats));
+    get_program_binary =
+        (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+    program_binary =
+        (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+    if ((nr_formats <= 0) || !get_program_binary || !program_binary)
+    {
+        return;
+    }
+
+    std::string cache_home;
+    if (getenv("XDG_CACHE_HOME"))
+    {
+        cache_home = getenv("XDG_CACHE_HOME");
+    } else if (getenv("HOME"))
+    {
+        cache_home = std::string(getenv("HOME")) + "/.cache";
+    } else
+    {
+        return;
+    }
+
+    directory = cache_home + "/wayfire/programs";
+    if (!make_directory(cache_home) || !make_directory(cache_home + "/wayfire") ||
+        !make_directory(directory))
+    {
+        LOGE("Failed to create the GL program cache directory ", directory);
+        return;
+    }
+
+    driver = get_gl_string(GL_VENDOR) + "\n" + get_gl_string(GL_RENDERER) +
+        "\n" + get_gl_string(GL_VERSION);
+    enabled = true;
+}
+
+std::string OpenGL::program_cache_t::get_path(const std::string& vertex_source,
+    const std::string& frag_source) const
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    hash = hash_string(hash, driver);
+    hash = hash_string(hash, vertex_source);
+    hash = hash_string(hash, frag_source);
+
+    char name[32];
+    snprintf(name, sizeof(name), "/%016" PRIx64 ".bin", hash);
+    return directory + name;
+}
+
+GLuint OpenGL::program_cache_t::load(const std::string& vertex_source,
+    const std::string& frag_source)
+{
+    if (!enabled)
+    {
+        return 0;
+    }
+
+    std::ifstream file{get_path(vertex_source, frag_source), std::ios::binary};
+    cache_header_t header;
+    if (!file.read((char*)&header, sizeof(header)) ||
+        (header.magic != CACHE_MAGIC))
+    {
+        return 0;
+    }
+
+    std::vector<char> binary{std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>()};
+    if (binary.empty())
+    {
+        return 0;
+    }
+
+    GLuint program = GL_CALL(glCreateProgram());
+    GL_CALL(program_binary(program, header.format, binary.data(),
+        binary.size()));
+
+    /* Drivers reject binaries they can't use, for ex. after an update */
+    GLint status = GL_FALSE;
+    GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+    if (status == GL_FALSE)
+    {
+        GL_CALL(glDeleteProgram(program));
+        return 0;
+    }
+
+    return program;
+}
+
+void OpenGL::program_cache_t::store(const std::string& vertex_source,
+    const std::string& frag_source, GLuint program)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    GLint length = 0;
+    GL_CALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length));
+    if (length <= 0)
+    {
+        return;
+    }
+
+    auto data = std::make_shared<std::vector<char>>(
+        sizeof(cache_header_t) + length);
+    cache_header_t header{CACHE_MAGIC, 0};
+    GL_CALL(get_program_binary(program, length, &length, &header.format,
+        data->data() + sizeof(header)));
+    data->resize(sizeof(header) + length);
+    std::memcpy(data->data(), &header, sizeof(header));
+
+    /* Other instances, or another store of the same program, may write the
+     * file concurrently, so it is written under a unique name and renamed */
+    static uint64_t nr_stores = 0;
+    auto path = get_path(vertex_source, frag_source);
+    auto tmp  = path + "." + std::to_string(getpid()) + "." +
+        std::to_string(nr_stores++);
+
+    wf::worker_pool_t::get().submit([=] ()
+    {
+        std::ofstream file{tmp, std::ios::binary | std::ios::trunc};
+        file.write(data->data(), data->size());
+        file.close();
+        if (!file || (rename(tmp.c_str(), path.c_str()) != 0))
+        {
+            unlink(tmp.c_str());
+        }
+    });
+}
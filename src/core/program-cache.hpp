@@ -0,0 +1,62 @@
+#ifndef WF_PROGRAM_CACHE_HPP
+#define WF_PROGRAM_CACHE_HPP
+
+#include <wayfire/opengl.hpp>
+#include <string>
+
+namespace OpenGL
+{
+/**
+ * Keeps the binaries of linked GL programs in the user's cache directory, so
+ * that the programs of the core and of the plugins do not have to be compiled
+ * again at each startup or plugin reload.
+ *
+ * Binaries are looked up by a hash of the shader sources and of the GL vendor,
+ * renderer and version, so updating the driver or changing the GPU results
+ * in new binaries. Binaries which the driver rejects anyway are replaced
+ * after compiling the program from source.
+ *
+ * Requires GL_OES_get_program_binary. Without it, the cache is disabled and
+ * all programs are compiled.
+ */
+class program_cache_t
+{
+  public:
+    /** Must be called with the GL context current. */
+    program_cache_t();
+
+    program_cache_t(const program_cache_t &) = delete;
+    program_cache_t& operator =(const program_cache_t&) = delete;
+
+    /** Whether the driver supports program binaries and the directory exists. */
+    bool is_enabled() const
+    {
+        return enabled;
+    }
+
+    /**
+     * Create a program from the cached binary for the given sources.
+     *
+     * @return The linked program, or 0 if there is no usable binary.
+     */
+    GLuint load(const std::string& vertex_source,
+        const std::string& frag_source);
+
+    /**
+     * Store the binary of a program which was successfully linked from the
+     * given sources. The file is written on the worker pool.
+     */
+    void store(const std::string& vertex_source,
+        const std::string& frag_source, GLuint program);
+
+  private:
+    bool enabled = false;
+    std::string directory;
+    std::string driver;
+
+    std::string get_path(const std::string& vertex_source,
+        const std::string& frag_source) const;
+};
+}
+
+#endif /* end of include guard: WF_PROGRAM_CACHE_HPP */
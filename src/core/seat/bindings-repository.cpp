@@ -2,53 +2,75 @@
 #include <wayfire/core.hpp>
 #include <algorithm>
 
-bool wf::bindings_repository_t::handle_key(const wf::keybinding_t& pressed,
-    uint32_t mod_binding_key)
+namespace
+{
+uint64_t combine(uint32_t modifiers, uint32_t code)
+{
+    return ((uint64_t)modifiers << 32) | code;
+}
+}
+
+template<class Option, class Callback, class Value>
+auto wf::bindings_repository_t::find_matching(dispatch_index_t<Callback>& index,
+    binding_container_t<Option, Callback>& bindings, const Value& value,
+    uint64_t combination, bool with_activators) ->
+std::shared_ptr<const dispatch_entry_t<Callback>>
 {
-    std::vector<std::function<bool()>> callbacks;
-    for (auto& binding : this->keys)
+    auto it = index.find(combination);
+    if (it != index.end())
+    {
+        return it->second;
+    }
+
+    auto entry = std::make_shared<dispatch_entry_t<Callback>>();
+    for (auto& binding : bindings)
     {
-        if (binding->activated_by->get_value() == pressed)
+        if (binding->activated_by->get_value() == value)
         {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([pressed, callback] ()
-            {
-                return (*callback)(pressed);
-            });
+            entry->bindings.push_back(binding->callback);
         }
     }
 
     for (auto& binding : this->activators)
     {
-        if (binding->activated_by->get_value().has_match(pressed))
+        if (with_activators &&
+            binding->activated_by->get_value().has_match(value))
         {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([pressed, callback, mod_binding_key] ()
-            {
-                wf::activator_data_t ev = {
-                    .source = activator_source_t::KEYBINDING,
-                    .activation_data = pressed.get_key()
-                };
-
-                if (mod_binding_key)
-                {
-                    ev.source = activator_source_t::MODIFIERBINDING;
-                    ev.activation_data = mod_binding_key;
-                }
-
-                return (*callback)(ev);
-            });
+            entry->activators.push_back(binding->callback);
         }
     }
 
+    index[combination] = entry;
+    return entry;
+}
+
+bool wf::bindings_repository_t::handle_key(const wf::keybinding_t& pressed,
+    uint32_t mod_binding_key)
+{
+    /* Hold a reference, because the callbacks might change the bindings */
+    auto matching = find_matching(key_index, keys, pressed,
+        combine(pressed.get_modifiers(), pressed.get_key()), true);
+
     bool handled = false;
-    for (auto& cb : callbacks)
+    for (auto callback : matching->bindings)
     {
-        handled |= cb();
+        handled |= (*callback)(pressed);
+    }
+
+    for (auto callback : matching->activators)
+    {
+        wf::activator_data_t ev = {
+            .source = activator_source_t::KEYBINDING,
+            .activation_data = pressed.get_key()
+        };
+
+        if (mod_binding_key)
+        {
+            ev.source = activator_source_t::MODIFIERBINDING;
+            ev.activation_data = mod_binding_key;
+        }
+
+        handled |= (*callback)(ev);
     }
 
     return handled;
@@ -57,63 +79,35 @@ bool wf::bindings_repository_t::handle_key(const wf::keybinding_t& pressed,
 bool wf::bindings_repository_t::handle_axis(uint32_t modifiers,
     wlr_event_pointer_axis *ev)
 {
-    std::vector<wf::axis_callback*> callbacks;
-
-    for (auto& binding : this->axes)
-    {
-        if (binding->activated_by->get_value() == wf::keybinding_t{modifiers, 0})
-        {
-            callbacks.push_back(binding->callback);
-        }
-    }
+    auto matching = find_matching(axis_index, axes,
+        wf::keybinding_t{modifiers, 0}, combine(modifiers, 0), false);
 
-    for (auto call : callbacks)
+    for (auto call : matching->bindings)
     {
         (*call)(ev);
     }
 
-    return !callbacks.empty();
+    return !matching->bindings.empty();
 }
 
 bool wf::bindings_repository_t::handle_button(const wf::buttonbinding_t& pressed)
 {
-    std::vector<std::function<bool()>> callbacks;
-    for (auto& binding : this->buttons)
-    {
-        if (binding->activated_by->get_value() == pressed)
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([=] ()
-            {
-                return (*callback)(pressed);
-            });
-        }
-    }
+    auto matching = find_matching(button_index, buttons, pressed,
+        combine(pressed.get_modifiers(), pressed.get_button()), true);
 
-    for (auto& binding : this->activators)
+    bool binding_handled = false;
+    for (auto callback : matching->bindings)
     {
-        if (binding->activated_by->get_value().has_match(pressed))
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->callback;
-            callbacks.emplace_back([=] ()
-            {
-                wf::activator_data_t data = {
-                    .source = activator_source_t::BUTTONBINDING,
-                    .activation_data = pressed.get_button(),
-                };
-                return (*callback)(data);
-            });
-        }
+        binding_handled |= (*callback)(pressed);
     }
 
-    bool binding_handled = false;
-    for (auto call : callbacks)
+    for (auto callback : matching->activators)
     {
-        binding_handled |= call();
+        wf::activator_data_t data = {
+            .source = activator_source_t::BUTTONBINDING,
+            .activation_data = pressed.get_button(),
+        };
+        binding_handled |= (*callback)(data);
     }
 
     return binding_handled;
@@ -149,7 +143,12 @@ void wf::bindings_repository_t::handle_gesture(const wf::touchgesture_t& gesture
 bool wf::bindings_repository_t::handle_activator(
     const std::string& activator, const wf::activator_data_t& data)
 {
-    auto opt = wf::get_core().config.get_option(activator);
+    auto& opt = activator_options[activator];
+    if (!opt)
+    {
+        opt = wf::get_core().config.get_option(activator);
+    }
+
     for (auto& act : this->activators)
     {
         if (act->activated_by == opt)
@@ -163,12 +162,18 @@ bool wf::bindings_repository_t::handle_activator(
 
 void wf::bindings_repository_t::rem_binding(void *callback)
 {
-    const auto& erase = [callback] (auto& container)
+    const auto& erase = [=] (auto& container)
     {
         auto it = std::remove_if(container.begin(), container.end(),
-            [callback] (const auto& ptr)
+            [=] (const auto& ptr)
         {
-            return ptr->callback == callback;
+            if (ptr->callback == callback)
+            {
+                binding_removed(ptr->activated_by.get());
+                return true;
+            }
+
+            return false;
         });
         container.erase(it, container.end());
     };
@@ -178,17 +183,24 @@ void wf::bindings_repository_t::rem_binding(void *callback)
     erase(axes);
     erase(activators);
 
+    reset_index();
     recreate_hotspots();
 }
 
 void wf::bindings_repository_t::rem_binding(binding_t *binding)
 {
-    const auto& erase = [binding] (auto& container)
+    const auto& erase = [=] (auto& container)
     {
         auto it = std::remove_if(container.begin(), container.end(),
-            [binding] (const auto& ptr)
+            [=] (const auto& ptr)
         {
-            return ptr.get() == binding;
+            if (ptr.get() == binding)
+            {
+                binding_removed(ptr->activated_by.get());
+                return true;
+            }
+
+            return false;
         });
         container.erase(it, container.end());
     };
@@ -198,20 +210,64 @@ void wf::bindings_repository_t::rem_binding(binding_t *binding)
     erase(axes);
     erase(activators);
 
+    reset_index();
     recreate_hotspots();
 }
 
+void wf::bindings_repository_t::binding_added(wf::config::option_base_t *option)
+{
+    if (bound_options[option]++ == 0)
+    {
+        option->add_updated_handler(&on_binding_updated);
+    }
+
+    reset_index();
+}
+
+void wf::bindings_repository_t::binding_removed(
+    wf::config::option_base_t *option)
+{
+    auto it = bound_options.find(option);
+    if ((it != bound_options.end()) && (--it->second == 0))
+    {
+        option->rem_updated_handler(&on_binding_updated);
+        bound_options.erase(it);
+    }
+}
+
+void wf::bindings_repository_t::reset_index()
+{
+    key_index.clear();
+    axis_index.clear();
+    button_index.clear();
+}
+
 wf::bindings_repository_t::bindings_repository_t(wf::output_t *output) :
     hotspot_mgr(output)
 {
+    on_binding_updated = [=] ()
+    {
+        reset_index();
+    };
+
     on_config_reload.set_callback([=] (wf::signal_data_t*)
     {
+        reset_index();
+        activator_options.clear();
         recreate_hotspots();
     });
 
     wf::get_core().connect_signal("reload-config", &on_config_reload);
 }
 
+wf::bindings_repository_t::~bindings_repository_t()
+{
+    for (auto& [option, count] : bound_options)
+    {
+        option->rem_updated_handler(&on_binding_updated);
+    }
+}
+
 void wf::bindings_repository_t::recreate_hotspots()
 {
     this->idle_recreate_hotspots.run_once([=] ()
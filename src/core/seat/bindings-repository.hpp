@@ -3,6 +3,7 @@
 #include "wayfire/geometry.hpp"
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include <wayfire/bindings.hpp>
 #include <wayfire/config/option-wrapper.hpp>
 #include <wayfire/config/types.hpp>
@@ -18,6 +19,7 @@ class bindings_repository_t
 {
   public:
     bindings_repository_t(wf::output_t *output);
+    ~bindings_repository_t();
 
     /**
      * Handle a keybinding pressed by the user.
@@ -68,6 +70,52 @@ class bindings_repository_t
     binding_container_t<wf::buttonbinding_t, button_callback> buttons;
     binding_container_t<wf::activatorbinding_t, activator_callback> activators;
 
+    /** Must be called by output_t after pushing a new binding. */
+    void binding_added(wf::config::option_base_t *option);
+    void binding_removed(wf::config::option_base_t *option);
+
+    /**
+     * The callbacks which match a single key, button or axis combination, in
+     * the order in which they are called.
+     */
+    template<class Callback>
+    struct dispatch_entry_t
+    {
+        std::vector<Callback*> bindings;
+        std::vector<activator_callback*> activators;
+    };
+
+    /**
+     * Maps a combination of modifiers and a key code/button to the matching
+     * callbacks. Entries are filled on the first event with the combination
+     * and are shared, so that a dispatch in progress is not affected if the
+     * index is reset by one of the callbacks.
+     */
+    template<class Callback>
+    using dispatch_index_t = std::unordered_map<uint64_t,
+        std::shared_ptr<const dispatch_entry_t<Callback>>>;
+
+    dispatch_index_t<key_callback> key_index;
+    dispatch_index_t<axis_callback> axis_index;
+    dispatch_index_t<button_callback> button_index;
+
+    template<class Option, class Callback, class Value>
+    std::shared_ptr<const dispatch_entry_t<Callback>> find_matching(
+        dispatch_index_t<Callback>& index,
+        binding_container_t<Option, Callback>& bindings,
+        const Value& value, uint64_t combination, bool with_activators);
+
+    /** Drop all index entries, they are lazily rebuilt on the next event. */
+    void reset_index();
+
+    /** The options of all bindings, and how many bindings use each of them */
+    std::unordered_map<wf::config::option_base_t*, int> bound_options;
+    wf::config::option_base_t::updated_callback_t on_binding_updated;
+
+    /** Activator options by name, as requested by handle_activator() */
+    std::unordered_map<std::string,
+        std::shared_ptr<wf::config::option_base_t>> activator_options;
+
     hotspot_manager_t hotspot_mgr;
 
     wf::signal_connection_t on_config_reload;
@@ -141,8 +141,21 @@ wf::input_manager_t::input_manager_t()
     });
     input_device_created.connect(&wf::get_core().backend->events.new_input);
 
-    config_updated.set_callback([=] (wf::signal_data_t*)
+    config_updated.set_callback([=] (wf::signal_data_t *data)
     {
+        if (!wf::config_section_changed(data, "input") &&
+            !wf::config_section_changed(data, "input-device:"))
+        {
+            return;
+        }
+
+        /* Before the keyboards reload their keymaps, which happens in their
+         * own handlers of this signal, connected after this one */
+        if (wf::config_section_changed(data, "input"))
+        {
+            wf::keyboard_t::clear_keymap_cache();
+        }
+
         for (auto& dev : input_devices)
         {
             dev->update_options();
@@ -263,23 +276,12 @@ wf::surface_interface_t*wf::input_manager_t::input_surface_at(
     global.x -= og.x;
     global.y -= og.y;
 
-    for (auto& v : output->workspace->get_views_in_layer(wf::VISIBLE_LAYERS))
+    auto impl = dynamic_cast<wf::output_impl_t*>(output);
+    return impl->get_input_surface_index().input_surface_at(global, local,
+        [=] (wf::view_interface_t *view)
     {
-        for (auto& view : v->enumerate_views())
-        {
-            if (!view->minimized && view->is_visible() &&
-                can_focus_surface(view.get()))
-            {
-                auto surface = view->map_input_coordinates(global, local);
-                if (surface)
-                {
-                    return surface;
-                }
-            }
-        }
-    }
-
-    return nullptr;
+        return !view->minimized && view->is_visible() && can_focus_surface(view);
+    });
 }
 
 void wf::input_manager_t::set_exclusive_focus(wl_client *client)
@@ -12,11 +12,22 @@
 #include "input-manager.hpp"
 #include "wayfire/compositor-view.hpp"
 #include "wayfire/signal-definitions.hpp"
+#include "wayfire/worker-pool.hpp"
+#include "../startup-profiler.hpp"
+#include <array>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 
 void wf::keyboard_t::setup_listeners()
 {
-    on_config_reload.set_callback([&] (signal_data_t*)
+    on_config_reload.set_callback([&] (signal_data_t *data)
     {
+        if (!wf::config_section_changed(data, "input"))
+        {
+            return;
+        }
+
         reload_input_options();
     });
     wf::get_core().connect_signal("reload-config", &on_config_reload);
@@ -95,6 +106,146 @@ static void set_locked_mod(xkb_mod_mask_t *mods, xkb_keymap *keymap, const char
     }
 }
 
+namespace
+{
+/* rules, model, layout, variant and options */
+using keymap_names_t = std::array<std::string, 5>;
+
+/**
+ * Compiled keymaps, by their names. Keyboards usually share the same names,
+ * and compiling a keymap takes a while, so each keymap is compiled once.
+ * The cache holds a reference to each keymap.
+ */
+std::map<keymap_names_t, xkb_keymap*> keymap_cache;
+
+/** Compile a keymap in its own context, so that it can run on any thread. */
+xkb_keymap *compile_keymap(const keymap_names_t& names)
+{
+    xkb_rule_names rule_names;
+    rule_names.rules   = names[0].c_str();
+    rule_names.model   = names[1].c_str();
+    rule_names.layout  = names[2].c_str();
+    rule_names.variant = names[3].c_str();
+    rule_names.options = names[4].c_str();
+
+    auto ctx    = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    auto keymap = xkb_map_new_from_names(ctx, &rule_names,
+        XKB_KEYMAP_COMPILE_NO_FLAGS);
+    xkb_context_unref(ctx);
+
+    return keymap;
+}
+
+/** A keymap which is being compiled on the worker pool */
+struct prepared_keymap_t
+{
+    keymap_names_t names;
+
+    std::mutex mutex;
+    std::condition_variable compiled;
+    bool ready = false;
+    xkb_keymap *keymap = nullptr;
+
+    ~prepared_keymap_t()
+    {
+        if (keymap)
+        {
+            xkb_keymap_unref(keymap);
+        }
+    }
+};
+
+/** The keymap compiled by wf::keyboard_t::prepare_keymap(), until it is cached */
+std::shared_ptr<prepared_keymap_t> prepared_keymap;
+
+/** Wait until the prepared keymap is compiled, and move it to the cache. */
+void cache_prepared_keymap()
+{
+    auto prepared = std::move(prepared_keymap);
+    prepared_keymap = nullptr;
+
+    std::unique_lock<std::mutex> lock(prepared->mutex);
+    prepared->compiled.wait(lock, [&] { return prepared->ready; });
+    if (prepared->keymap &&
+        keymap_cache.emplace(prepared->names, prepared->keymap).second)
+    {
+        prepared->keymap = nullptr;
+    }
+}
+
+/** Get a new reference to the keymap with the given names. */
+xkb_keymap *get_keymap(const keymap_names_t& names)
+{
+    /* Keyboards are usually created while the keymap is still being compiled,
+     * wait for it instead of compiling it a second time */
+    if (prepared_keymap && (prepared_keymap->names == names))
+    {
+        cache_prepared_keymap();
+    }
+
+    auto it = keymap_cache.find(names);
+    if (it != keymap_cache.end())
+    {
+        return xkb_keymap_ref(it->second);
+    }
+
+    auto keymap = compile_keymap(names);
+    if (keymap)
+    {
+        keymap_cache[names] = xkb_keymap_ref(keymap);
+    }
+
+    return keymap;
+}
+
+keymap_names_t get_configured_keymap_names()
+{
+    return {
+        wf::option_wrapper_t<std::string>{"input/xkb_rules"},
+        wf::option_wrapper_t<std::string>{"input/xkb_model"},
+        wf::option_wrapper_t<std::string>{"input/xkb_layout"},
+        wf::option_wrapper_t<std::string>{"input/xkb_variant"},
+        wf::option_wrapper_t<std::string>{"input/xkb_options"},
+    };
+}
+}
+
+void wf::keyboard_t::prepare_keymap()
+{
+    auto prepared = std::make_shared<prepared_keymap_t>();
+    prepared->names = get_configured_keymap_names();
+    prepared_keymap = prepared;
+
+    wf::worker_pool_t::get().submit([=] ()
+    {
+        wf::startup_profiler_t::scope_t scope{"compile keymap"};
+        auto keymap = compile_keymap(prepared->names);
+
+        std::lock_guard<std::mutex> lock(prepared->mutex);
+        prepared->keymap = keymap;
+        prepared->ready  = true;
+        prepared->compiled.notify_all();
+    }, [=] ()
+    {
+        /* Unless a keyboard has taken it already, or it was dropped */
+        if (prepared_keymap == prepared)
+        {
+            cache_prepared_keymap();
+        }
+    });
+}
+
+void wf::keyboard_t::clear_keymap_cache()
+{
+    prepared_keymap = nullptr;
+    for (auto& [names, keymap] : keymap_cache)
+    {
+        xkb_keymap_unref(keymap);
+    }
+
+    keymap_cache.clear();
+}
+
 void wf::keyboard_t::reload_input_options()
 {
     if (!this->dirty_options)
@@ -104,33 +255,17 @@ void wf::keyboard_t::reload_input_options()
 
     this->dirty_options = false;
 
-    auto ctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-
-    /* Copy memory to stack, so that .c_str() is valid */
-    std::string rules   = this->rules;
-    std::string model   = this->model;
-    std::string layout  = this->layout;
-    std::string variant = this->variant;
-    std::string options = this->options;
-
-    xkb_rule_names names;
-    names.rules   = rules.c_str();
-    names.model   = model.c_str();
-    names.layout  = layout.c_str();
-    names.variant = variant.c_str();
-    names.options = options.c_str();
-    auto keymap = xkb_map_new_from_names(ctx, &names,
-        XKB_KEYMAP_COMPILE_NO_FLAGS);
-
+    keymap_names_t names = {rules, model, layout, variant, options};
+    auto keymap = get_keymap(names);
     if (!keymap)
     {
         LOGE("Could not create keymap with given configuration:",
-            " rules=\"", rules, "\" model=\"", model, "\" layout=\"", layout,
-            "\" variant=\"", variant, "\" options=\"", options, "\"");
+            " rules=\"", names[0], "\" model=\"", names[1],
+            "\" layout=\"", names[2], "\" variant=\"", names[3],
+            "\" options=\"", names[4], "\"");
 
         // reset to NULL
-        std::memset(&names, 0, sizeof(names));
-        keymap = xkb_map_new_from_names(ctx, &names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+        keymap = get_keymap({});
     }
 
     xkb_mod_mask_t locked_mods = 0;
@@ -147,7 +282,6 @@ void wf::keyboard_t::reload_input_options()
 
     wlr_keyboard_set_keymap(handle, keymap);
     xkb_keymap_unref(keymap);
-    xkb_context_unref(ctx);
 
     wlr_keyboard_set_repeat_info(handle, repeat_rate, repeat_delay);
 
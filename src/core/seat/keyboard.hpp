@@ -31,6 +31,19 @@ class keyboard_t
     /* The keycode which triggered the modifier binding */
     uint32_t mod_binding_key = 0;
 
+    /**
+     * Compile the keymap of the configured names on the worker pool, so that
+     * it is ready when the keyboards are created. Keyboards which need it
+     * before it is compiled wait for it instead of compiling it again.
+     */
+    static void prepare_keymap();
+
+    /**
+     * Drop the compiled keymaps, so that the keymaps are compiled again, for
+     * ex. after the input options or the keymap files have changed.
+     */
+    static void clear_keymap_cache();
+
   private:
     wf::wl_listener_wrapper on_key, on_modifier;
     void setup_listeners();
@@ -0,0 +1,107 @@
+#include "startup-profiler.hpp"
+#include "chrome-trace.hpp"
+#include <wayfire/util/log.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+wf::startup_profiler_t& wf::startup_profiler_t::get()
+{
+    static startup_profiler_t profiler;
+    return profiler;
+}
+
+void wf::startup_profiler_t::enable()
+{
+    main_thread = std::this_thread::get_id();
+    enabled     = true;
+}
+
+wf::startup_profiler_t::scope_t::scope_t(std::string name)
+{
+    auto& profiler = startup_profiler_t::get();
+    this->active = profiler.is_enabled();
+    if (active)
+    {
+        this->name  = std::move(name);
+        this->start = trace_now_us();
+        if (std::this_thread::get_id() == profiler.main_thread)
+        {
+            ++profiler.depth;
+        }
+    }
+}
+
+wf::startup_profiler_t::scope_t::~scope_t()
+{
+    auto& profiler = startup_profiler_t::get();
+    if (!active)
+    {
+        return;
+    }
+
+    bool main = (std::this_thread::get_id() == profiler.main_thread);
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    if (main)
+    {
+        --profiler.depth;
+    }
+
+    if (!profiler.finished)
+    {
+        profiler.events.push_back({std::move(name), main,
+            main ? profiler.depth : 0, start, trace_now_us() - start});
+    }
+}
+
+void wf::startup_profiler_t::finish()
+{
+    if (!is_enabled())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = true;
+
+    std::stable_sort(events.begin(), events.end(),
+        [] (const event_t& a, const event_t& b)
+    {
+        return a.start < b.start;
+    });
+
+    int64_t origin = events.empty() ? 0 : events.front().start;
+    std::ostringstream timeline;
+    for (auto& ev : events)
+    {
+        timeline << "\n" << ((ev.start - origin) / 1000.0) << " ms\t" <<
+            std::string(2 * ev.depth, ' ') << (ev.main_thread ? "" : "[worker] ") <<
+            ev.name << ": " << (ev.duration / 1000.0) << " ms";
+    }
+
+    LOGI("Startup timeline:", timeline.str());
+
+    const char *dir  = getenv("XDG_RUNTIME_DIR");
+    std::string path = std::string(dir ? dir : "/tmp") + "/wayfire-startup.json";
+    std::ofstream out{path};
+    write_chrome_trace(out);
+    LOGI("Wrote startup trace to ", path);
+
+    events.clear();
+}
+
+void wf::startup_profiler_t::write_chrome_trace(std::ostream& out)
+{
+    chrome_trace_writer_t trace{out};
+    trace.thread_name(0, "compositor");
+    trace.thread_name(1, "workers");
+    for (auto& ev : events)
+    {
+        trace.complete_event(ev.name, nullptr, ev.main_thread ? 0 : 1,
+            ev.start, ev.duration);
+    }
+
+    trace.finish();
+}
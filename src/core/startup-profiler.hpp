@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wf
+{
+/**
+ * Records how long each stage of the startup takes: core initialization,
+ * creation of the outputs, loading and initialization of each plugin on each
+ * output, and preparation work running on the worker pool.
+ *
+ * Enabled with --profile-startup. The timeline is logged and written in the
+ * Chrome trace format once the compositor has started.
+ */
+class startup_profiler_t
+{
+  public:
+    static startup_profiler_t& get();
+
+    /** Start recording, must be called on the compositor thread. */
+    void enable();
+
+    bool is_enabled() const
+    {
+        return enabled && !finished;
+    }
+
+    /**
+     * Records the time between its creation and destruction as a stage.
+     * Stages created while another one is alive are nested in it. Scopes may
+     * be used on worker threads, where they are shown separately.
+     */
+    class scope_t
+    {
+      public:
+        scope_t(std::string name);
+        ~scope_t();
+
+        scope_t(const scope_t &) = delete;
+        scope_t& operator =(const scope_t&) = delete;
+
+      private:
+        std::string name;
+        int64_t start;
+        bool active;
+    };
+
+    /**
+     * Stop recording, log the timeline and write it to
+     * $XDG_RUNTIME_DIR/wayfire-startup.json.
+     */
+    void finish();
+
+  private:
+    startup_profiler_t() = default;
+
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> finished{false};
+    std::thread::id main_thread;
+
+    struct event_t
+    {
+        std::string name;
+        bool main_thread;
+        int depth;
+        /* Microseconds, relative to the steady clock epoch */
+        int64_t start;
+        int64_t duration;
+    };
+
+    /* Worker threads record events too */
+    std::mutex mutex;
+    std::vector<event_t> events;
+    /* Nesting depth of the scopes of the compositor thread */
+    int depth = 0;
+
+    void write_chrome_trace(std::ostream& out);
+};
+}
@@ -1,11 +1,35 @@
 #include <wayfire/debug.hpp>
+#include <algorithm>
 #include <iostream>
+#include <unordered_map>
 #include "transaction-priv.hpp"
 
 namespace wf
 {
 namespace txn
 {
+namespace
+{
+/**
+ * The IDs of a transaction signal, which is emitted on the manager and, with a
+ * "transaction-" prefix, on each view of the transaction.
+ */
+struct txn_signal_ids_t
+{
+    wf::signal_id_t manager;
+    wf::signal_id_t view;
+
+    txn_signal_ids_t(const std::string& name) :
+        manager(wf::get_signal_id(name)),
+        view(wf::get_signal_id("transaction-" + name))
+    {}
+};
+
+const txn_signal_ids_t pending_ids{"pending"};
+const txn_signal_ids_t ready_ids{"ready"};
+const txn_signal_ids_t done_ids{"done"};
+}
+
 class transaction_manager_t::impl
 {
   public:
@@ -17,38 +41,52 @@ class transaction_manager_t::impl
 
     uint64_t submit(transaction_uptr_t tx)
     {
-        if (tx->get_objects().empty())
+        auto tx_impl = dynamic_cast<transaction_impl_t*>(tx.get());
+        if (tx_impl->get_object_ids().empty())
         {
             // TODO: add tests for this case, and add docs
             return 0;
         }
 
-        auto tx_impl = dynamic_cast<transaction_impl_t*>(tx.release());
+        tx.release();
 
         // We first set id to the transaction.
         // It may be merged into the mega transaction later.
         set_id(tx_impl);
 
         LOGC(TXN, "New transaction ", tx_impl->get_id());
+        ++stats.submitted;
         tx_impl->set_pending();
         tx_impl->connect_signal("done", &on_tx_done);
         collect_instructions(tx_impl);
 
         auto tx_iuptr = transaction_iuptr_t(tx_impl);
-        if (is_conflict(tx_iuptr))
+        if (is_conflict(*tx_iuptr))
         {
             LOGC(TXN, "Merging into mega transaction");
+            ++stats.merged;
             if (mega_transaction)
             {
+                // Objects already in the mega transaction keep their owner
+                for (auto object : tx_iuptr->get_object_ids())
+                {
+                    if (!mega_transaction->has_object(object))
+                    {
+                        ++owners[object].pending;
+                    }
+                }
+
                 mega_transaction->merge(std::move(tx_iuptr));
             } else
             {
+                own(*tx_iuptr);
                 mega_transaction = std::move(tx_iuptr);
             }
 
             return mega_transaction->get_id();
         }
 
+        own(*tx_iuptr);
         pending_idle.push_back(std::move(tx_iuptr));
         // Schedule for running later
         idle_commit.run_once();
@@ -56,7 +94,13 @@ class transaction_manager_t::impl
         return tx_impl->get_id();
     }
 
+    const transaction_stats_t& get_stats() const
+    {
+        return stats;
+    }
+
   private:
+    transaction_stats_t stats;
     uint64_t free_id = 0;
 
     void set_id(transaction_impl_t *tx)
@@ -72,48 +116,85 @@ class transaction_manager_t::impl
         while (tx->is_dirty())
         {
             tx->clear_dirty();
-            emit_signal("pending", &ev);
+            emit_signal(pending_ids, &ev);
         }
     }
 
     // Transactions that will be committed on next idle
     std::vector<transaction_iuptr_t> pending_idle;
 
-    // Check whether tx has a conflict with an already scheduled transaction.
-    bool is_conflict(const transaction_iuptr_t& tx,
-        const transaction_iuptr_t& scheduled)
+    /**
+     * The number of active (pending or committed) transactions which have
+     * instructions for an object. This makes conflict checks independent of
+     * the number of active transactions.
+     */
+    struct object_owners_t
     {
-        if (!scheduled)
+        uint32_t pending   = 0;
+        uint32_t committed = 0;
+    };
+
+    // Objects without active transactions are not in the map.
+    std::unordered_map<object_id_t, object_owners_t> owners;
+
+    // Add tx as a pending owner of its objects.
+    void own(const transaction_impl_t& tx)
+    {
+        for (auto object : tx.get_object_ids())
         {
-            return false;
+            ++owners[object].pending;
         }
+    }
 
-        if ((scheduled->get_state() != TXN_COMMITTED) &&
-            (scheduled->get_state() != TXN_PENDING))
+    // Move tx from a pending to a committed owner of its objects.
+    void own_committed(const transaction_impl_t& tx)
+    {
+        for (auto object : tx.get_object_ids())
         {
-            // Transaction already DONE, TIMED_OUT or CANCELLED
-            return false;
+            auto& owner = owners[object];
+            assert(owner.pending > 0);
+            --owner.pending;
+            ++owner.committed;
         }
-
-        return scheduled->does_intersect(*tx);
     }
 
-    // Check whether a transaction has a conflict with a pending or committed
-    // transactions
-    bool is_conflict(const transaction_iuptr_t& tx)
+    // Remove tx as an owner of its objects, after it is done.
+    void disown(const transaction_impl_t& tx, bool was_committed)
     {
-        if (is_conflict(tx, mega_transaction))
+        for (auto object : tx.get_object_ids())
         {
-            return true;
-        }
+            auto it = owners.find(object);
+            assert(it != owners.end());
 
-        bool with_pending = std::any_of(pending_idle.begin(), pending_idle.end(),
-            [&tx, this] (const auto& ptx) { return is_conflict(tx, ptx); });
+            auto& count = was_committed ? it->second.committed :
+                it->second.pending;
+            assert(count > 0);
+            --count;
 
-        bool with_committed = std::any_of(committed.begin(), committed.end(),
-            [&tx, this] (const auto& ctx) { return is_conflict(tx, ctx); });
+            if (!it->second.pending && !it->second.committed)
+            {
+                owners.erase(it);
+            }
+        }
+    }
+
+    // Check whether a transaction has a conflict with a pending or committed
+    // transactions
+    bool is_conflict(const transaction_impl_t& tx)
+    {
+        return std::any_of(tx.get_object_ids().begin(), tx.get_object_ids().end(),
+            [=] (object_id_t object) { return owners.count(object); });
+    }
 
-        return with_pending || with_committed;
+    // Check whether a transaction has a conflict with committed transactions
+    bool is_committed_conflict(const transaction_impl_t& tx)
+    {
+        return std::any_of(tx.get_object_ids().begin(), tx.get_object_ids().end(),
+            [=] (object_id_t object)
+        {
+            auto it = owners.find(object);
+            return (it != owners.end()) && it->second.committed;
+        });
     }
 
     wf::wl_idle_call idle_commit;
@@ -126,10 +207,7 @@ class transaction_manager_t::impl
                 return false;
             }
 
-            bool can_commit = std::none_of(committed.begin(), committed.end(),
-                [&tx, this] (const auto& ctx) { return is_conflict(tx, ctx); });
-
-            if (can_commit)
+            if (!is_committed_conflict(*tx))
             {
                 do_commit(std::move(tx));
                 return true;
@@ -180,6 +258,11 @@ class transaction_manager_t::impl
         auto ev  = static_cast<priv_done_signal*>(data);
         auto& tx = find_transaction(ev->id);
 
+        bool was_committed = std::any_of(committed.begin(), committed.end(),
+            [&] (const auto& ctx) { return ctx == tx; });
+        disown(*tx, was_committed);
+        record_done(*tx, ev->state);
+
         ready_signal emit_ev;
         emit_ev.tx = {tx};
 
@@ -190,9 +273,9 @@ class transaction_manager_t::impl
           case TXN_TIMED_OUT:
             LOGC(TXN, "Applying transaction ", tx->get_id(),
                 " (timeout: ", ev->state == TXN_TIMED_OUT, ")");
-            emit_signal("ready", &emit_ev);
+            emit_signal(ready_ids, &emit_ev);
             tx->apply();
-            emit_signal("done", &emit_ev);
+            emit_signal(done_ids, &emit_ev);
 
             // NB: we need to first commit the next instruction, and clean up
             // after that. This way, surface locks can be transferred from the
@@ -203,7 +286,7 @@ class transaction_manager_t::impl
 
           case TXN_CANCELLED:
             LOGC(TXN, "Transaction ", tx->get_id(), " cancelled");
-            emit_signal("done", &emit_ev);
+            emit_signal(done_ids, &emit_ev);
 
             // NB: we need to first commit the next instruction, and clean up
             // after that. This way, surface locks can be transferred from the
@@ -217,6 +300,36 @@ class transaction_manager_t::impl
         }
     };
 
+    void record_done(const transaction_impl_t& tx, transaction_state_t state)
+    {
+        auto& times = tx.get_timestamps();
+        switch (state)
+        {
+          case TXN_READY:
+            ++stats.applied;
+            break;
+
+          case TXN_TIMED_OUT:
+            ++stats.timed_out;
+            for (auto& object : tx.get_unready_objects())
+            {
+                stats.add_stalled_object(object);
+            }
+
+            break;
+
+          default:
+            ++stats.cancelled;
+            return;
+        }
+
+        transaction_stats_t::add_sample(stats.time_to_ready,
+            times.done - times.committed);
+        LOGC(TXN, "Transaction ", tx.get_id(), " waited ",
+            times.committed - times.pending, "ms for commit and ",
+            times.done - times.committed, "ms for readiness");
+    }
+
     transaction_iuptr_t& find_transaction(uint64_t id)
     {
         if (mega_transaction && (id == mega_transaction->get_id()))
@@ -247,16 +360,24 @@ class transaction_manager_t::impl
     void do_commit(transaction_iuptr_t tx)
     {
         LOGC(TXN, "Committing transaction ", tx->get_id());
+        own_committed(*tx);
+
+        ++stats.committed;
+        transaction_stats_t::add_sample(stats.instructions,
+            tx->get_instruction_count());
+        transaction_stats_t::add_sample(stats.time_to_commit,
+            wf::get_current_time() - tx->get_timestamps().pending);
+
         committed.push_back(std::move(tx));
         committed.back()->commit();
     }
 
-    void emit_signal(const std::string& name, transaction_signal *data)
+    void emit_signal(const txn_signal_ids_t& ids, transaction_signal *data)
     {
-        transaction_manager_t::get().emit_signal(name, data);
+        transaction_manager_t::get().emit_signal(ids.manager, data);
         for (auto view : data->tx->get_views())
         {
-            view->emit_signal("transaction-" + name, data);
+            view->emit_signal(ids.view, data);
         }
     }
 
@@ -290,6 +411,92 @@ uint64_t transaction_manager_t::submit(transaction_uptr_t tx)
     return priv->submit(std::move(tx));
 }
 
+void transaction_stats_t::add_sample(histogram_t& histogram, uint64_t value)
+{
+    size_t bucket = 0;
+    while (value > 0 && bucket < histogram.size() - 1)
+    {
+        value >>= 1;
+        ++bucket;
+    }
+
+    ++histogram[bucket];
+}
+
+void transaction_stats_t::add_stalled_object(const std::string& object)
+{
+    auto it = stalled_objects.find(object);
+    if (it != stalled_objects.end())
+    {
+        ++it->second;
+        return;
+    }
+
+    if (stalled_objects.size() >= MAX_STALLED_OBJECTS)
+    {
+        stalled_objects.erase(std::min_element(stalled_objects.begin(),
+            stalled_objects.end(), [] (const auto& a, const auto& b)
+        {
+            return a.second < b.second;
+        }));
+    }
+
+    stalled_objects[object] = 1;
+}
+
+const transaction_stats_t& transaction_manager_t::get_stats() const
+{
+    return priv->get_stats();
+}
+
+static void dump_histogram(std::ostream& out, const std::string& name,
+    const transaction_stats_t::histogram_t& histogram)
+{
+    out << name << ":";
+    for (size_t i = 0; i < histogram.size(); i++)
+    {
+        if (!histogram[i])
+        {
+            continue;
+        }
+
+        uint64_t low = (i == 0) ? 0 : (1ull << (i - 1));
+        out << " [" << low;
+        if (i + 1 < histogram.size())
+        {
+            out << "," << (1ull << i) << ")";
+        } else
+        {
+            out << ",+)";
+        }
+
+        out << "=" << histogram[i];
+    }
+
+    out << std::endl;
+}
+
+void transaction_manager_t::dump_stats(std::ostream& out) const
+{
+    auto& stats = get_stats();
+    out << "submitted=" << stats.submitted << " merged=" << stats.merged <<
+        " committed=" << stats.committed << " applied=" << stats.applied <<
+        " timed_out=" << stats.timed_out << " cancelled=" << stats.cancelled <<
+        std::endl;
+
+    dump_histogram(out, "time to commit (ms)", stats.time_to_commit);
+    dump_histogram(out, "time to ready (ms)", stats.time_to_ready);
+    dump_histogram(out, "instructions", stats.instructions);
+
+    out << "stalled objects:";
+    for (auto& [object, count] : stats.stalled_objects)
+    {
+        out << " " << object << "=" << count;
+    }
+
+    out << std::endl;
+}
+
 transaction_manager_t::transaction_manager_t()
 {
     this->priv = std::make_unique<impl>();
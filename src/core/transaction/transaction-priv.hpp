@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <vector>
 #include <wayfire/transaction/transaction.hpp>
 #include <wayfire/util.hpp>
 #include <wayfire/option-wrapper.hpp>
@@ -12,6 +13,24 @@ namespace txn
 class transaction_impl_t;
 using transaction_iuptr_t = std::unique_ptr<transaction_impl_t>;
 
+/**
+ * An interned instruction object identifier.
+ */
+using object_id_t = uint32_t;
+
+/**
+ * Get the ID of the given object identifier and add a reference to it. The
+ * same identifier results in the same ID as long as it is referenced, so that
+ * objects can be compared without comparing strings.
+ */
+object_id_t intern_object(const std::string& object);
+
+/**
+ * Release a reference obtained with intern_object(). Identifiers without
+ * references are forgotten and their IDs are reused.
+ */
+void release_object(object_id_t id);
+
 /**
  * Same as txn::done_signal, but on the transaction itself.
  */
@@ -28,6 +47,7 @@ class transaction_impl_t : public transaction_t, public signal_provider_t
 {
   public:
     transaction_impl_t();
+    ~transaction_impl_t();
 
     /**
      * Set all instructions as pending.
@@ -68,6 +88,39 @@ class transaction_impl_t : public transaction_t, public signal_provider_t
     std::set<std::string> get_objects() const override;
     std::set<wayfire_view> get_views() const override;
 
+    /**
+     * Get the IDs of all objects influenced by this transaction, sorted and
+     * without duplicates.
+     */
+    const std::vector<object_id_t>& get_object_ids() const;
+
+    /** Check whether the transaction has instructions for the given object. */
+    bool has_object(object_id_t object) const;
+
+    /** Get the number of instructions in the transaction. */
+    size_t get_instruction_count() const
+    {
+        return instructions.size();
+    }
+
+    /**
+     * Get the objects of all instructions which did not become ready yet.
+     */
+    std::vector<std::string> get_unready_objects() const;
+
+    /**
+     * Timestamps (see wf::get_current_time()) of the stages the transaction
+     * has passed through, for debugging and statistics.
+     */
+    struct timestamps_t
+    {
+        uint32_t pending   = 0;
+        uint32_t committed = 0;
+        uint32_t done = 0;
+    };
+
+    const timestamps_t& get_timestamps() const;
+
     /**
      * Set the ID.
      */
@@ -99,6 +152,9 @@ class transaction_impl_t : public transaction_t, public signal_provider_t
 
     transaction_state_t state = TXN_NEW;
     std::vector<instruction_uptr_t> instructions;
+    std::vector<object_id_t> object_ids;
+    std::set<instruction_t*> ready_instructions;
+    timestamps_t timestamps;
 
     wf::signal_connection_t on_instruction_cancel;
     wf::signal_connection_t on_instruction_ready;
@@ -3,10 +3,67 @@
 #include "transaction-priv.hpp"
 #include "../core-impl.hpp"
 
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
 namespace wf
 {
 namespace txn
 {
+namespace
+{
+struct interned_object_t
+{
+    object_id_t id;
+    uint32_t refs;
+};
+
+/* Only the objects of live transactions are interned */
+std::unordered_map<std::string, interned_object_t> interned_objects;
+/* The entry of each ID in interned_objects, or nullptr for free IDs */
+std::vector<std::pair<const std::string, interned_object_t>*> objects_by_id;
+std::vector<object_id_t> free_ids;
+}
+
+object_id_t intern_object(const std::string& object)
+{
+    auto it = interned_objects.find(object);
+    if (it != interned_objects.end())
+    {
+        ++it->second.refs;
+        return it->second.id;
+    }
+
+    object_id_t id;
+    if (free_ids.empty())
+    {
+        id = objects_by_id.size();
+        objects_by_id.push_back(nullptr);
+    } else
+    {
+        id = free_ids.back();
+        free_ids.pop_back();
+    }
+
+    /* Pointers to elements of an unordered_map stay valid on insertion */
+    objects_by_id[id] = &*interned_objects.emplace(object,
+        interned_object_t{id, 1}).first;
+    return id;
+}
+
+void release_object(object_id_t id)
+{
+    auto entry = objects_by_id[id];
+    assert(entry && entry->second.refs > 0);
+    if (--entry->second.refs == 0)
+    {
+        interned_objects.erase(interned_objects.find(entry->first));
+        objects_by_id[id] = nullptr;
+        free_ids.push_back(id);
+    }
+}
+
 transaction_impl_t::transaction_impl_t()
 {
     this->on_instruction_cancel.set_callback([=] (wf::signal_data_t*)
@@ -21,6 +78,7 @@ transaction_impl_t::transaction_impl_t()
         auto ev = static_cast<instruction_ready_signal*>(data);
 
         ++instructions_done;
+        ready_instructions.insert(ev->instruction.get());
         LOGC(TXNI, "Transaction id=", this->id,
             ": instruction ", ev->instruction.get(),
             " is ready(ready=", instructions_done,
@@ -35,6 +93,14 @@ transaction_impl_t::transaction_impl_t()
     });
 }
 
+transaction_impl_t::~transaction_impl_t()
+{
+    for (auto object : object_ids)
+    {
+        release_object(object);
+    }
+}
+
 void transaction_impl_t::set_pending()
 {
     assert(this->state == TXN_NEW);
@@ -47,6 +113,7 @@ void transaction_impl_t::set_pending()
     }
 
     this->state = TXN_PENDING;
+    timestamps.pending = wf::get_current_time();
 }
 
 void transaction_impl_t::commit()
@@ -54,6 +121,7 @@ void transaction_impl_t::commit()
     assert(this->state == TXN_PENDING);
 
     this->state = TXN_COMMITTED;
+    timestamps.committed = wf::get_current_time();
     commit_timeout.set_timeout(timeout_ms, [=] ()
     {
         state = TXN_TIMED_OUT;
@@ -105,15 +173,25 @@ void transaction_impl_t::merge(transaction_iuptr_t other)
 
 bool transaction_impl_t::does_intersect(const transaction_impl_t& other) const
 {
-    auto objs = get_objects();
-    auto other_objs = other.get_objects();
-
-    std::vector<std::string> intersection;
+    auto it = object_ids.begin();
+    auto other_it = other.object_ids.begin();
+    while (it != object_ids.end() && other_it != other.object_ids.end())
+    {
+        if (*it == *other_it)
+        {
+            return true;
+        }
 
-    std::set_intersection(objs.begin(), objs.end(),
-        other_objs.begin(), other_objs.end(), std::back_inserter(intersection));
+        if (*it < *other_it)
+        {
+            ++it;
+        } else
+        {
+            ++other_it;
+        }
+    }
 
-    return !intersection.empty();
+    return false;
 }
 
 void transaction_impl_t::add_instruction(instruction_uptr_t instr)
@@ -137,6 +215,17 @@ void transaction_impl_t::add_instruction(instruction_uptr_t instr,
         }
     }
 
+    /* The transaction holds one reference to each of its objects */
+    auto object = intern_object(instr->get_object());
+    auto it     = std::lower_bound(object_ids.begin(), object_ids.end(), object);
+    if ((it == object_ids.end()) || (*it != object))
+    {
+        object_ids.insert(it, object);
+    } else
+    {
+        release_object(object);
+    }
+
     this->instructions.push_back(std::move(instr));
     this->dirty = true;
 }
@@ -152,6 +241,35 @@ std::set<std::string> transaction_impl_t::get_objects() const
     return objs;
 }
 
+const std::vector<object_id_t>& transaction_impl_t::get_object_ids() const
+{
+    return object_ids;
+}
+
+bool transaction_impl_t::has_object(object_id_t object) const
+{
+    return std::binary_search(object_ids.begin(), object_ids.end(), object);
+}
+
+std::vector<std::string> transaction_impl_t::get_unready_objects() const
+{
+    std::vector<std::string> objects;
+    for (auto& i : instructions)
+    {
+        if (!ready_instructions.count(i.get()))
+        {
+            objects.push_back(i->get_object());
+        }
+    }
+
+    return objects;
+}
+
+const transaction_impl_t::timestamps_t& transaction_impl_t::get_timestamps() const
+{
+    return timestamps;
+}
+
 std::set<wayfire_view> transaction_impl_t::get_views() const
 {
     std::set<wayfire_view> views;
@@ -171,6 +289,7 @@ void transaction_impl_t::emit_done(transaction_state_t end_state)
 {
     this->on_instruction_ready.disconnect();
     this->on_instruction_cancel.disconnect();
+    timestamps.done = wf::get_current_time();
 
     priv_done_signal ev;
     ev.id    = this->get_id();
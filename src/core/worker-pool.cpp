@@ -0,0 +1,325 @@
+#include <wayfire/worker-pool.hpp>
+#include <wayfire/util/log.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/core.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace
+{
+/** The state of a single parallel_for() call, shared with the workers */
+struct batch_t
+{
+    wf::worker_pool_t::range_func_t func;
+    size_t count;
+    size_t chunk_size;
+    size_t nr_chunks;
+    uint32_t deadline;
+
+    std::atomic<size_t> next_chunk{0};
+    /* Chunks which were either processed or skipped */
+    std::atomic<size_t> done_chunks{0};
+    std::atomic<size_t> processed{0};
+
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    /**
+     * Claim the next chunk and process it.
+     * @return false if there are no more chunks to claim.
+     */
+    bool run_next_chunk()
+    {
+        size_t idx = next_chunk.fetch_add(1);
+        if (idx >= nr_chunks)
+        {
+            return false;
+        }
+
+        if (!deadline || (wf::get_current_time() < deadline))
+        {
+            size_t start = idx * chunk_size;
+            size_t end   = std::min(count, start + chunk_size);
+            func(start, end);
+            processed += end - start;
+        }
+
+        if (++done_chunks == nr_chunks)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.notify_all();
+        }
+
+        return true;
+    }
+};
+}
+
+class wf::worker_pool_t::impl
+{
+  public:
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable has_jobs;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+
+    /* Callbacks of finished submit() jobs and their owners, run on the
+     * compositor thread */
+    std::mutex done_mutex;
+    std::vector<std::pair<const void*, std::function<void()>>> done_callbacks;
+    int done_fd = -1;
+
+    /* The number of unfinished jobs of each owner, protected by done_mutex */
+    std::unordered_map<const void*, int> owner_jobs;
+    std::condition_variable owner_done;
+
+    void worker_loop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                has_jobs.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (stopping)
+                {
+                    return;
+                }
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+
+    void push_job(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+
+        has_jobs.notify_one();
+    }
+
+    static int handle_done(int fd, uint32_t mask, void *data)
+    {
+        auto self = (impl*)data;
+
+        uint64_t value;
+        if (read(fd, &value, sizeof(value)) < 0)
+        {
+            return 0;
+        }
+
+        std::vector<std::pair<const void*, std::function<void()>>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(self->done_mutex);
+            std::swap(callbacks, self->done_callbacks);
+        }
+
+        for (auto& cb : callbacks)
+        {
+            cb.second();
+        }
+
+        return 0;
+    }
+};
+
+wf::worker_pool_t& wf::worker_pool_t::get()
+{
+    static worker_pool_t pool;
+    return pool;
+}
+
+wf::worker_pool_t::worker_pool_t()
+{
+    this->priv = std::make_unique<impl>();
+
+    /* The calling thread also takes part in parallel_for() */
+    int nr_threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+
+    /* Threads inherit the signal mask of their creator. Block all signals in
+     * the workers, so that signals sent to the process, for ex. SIGUSR1, are
+     * always delivered to the compositor thread, even if the pool is created
+     * before their handlers are set up. */
+    sigset_t all_signals, old_mask;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_mask);
+    for (int i = 0; i < nr_threads; i++)
+    {
+        priv->threads.emplace_back([this] { priv->worker_loop(); });
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+
+    priv->done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    wl_event_loop_add_fd(wf::get_core().ev_loop, priv->done_fd,
+        WL_EVENT_READABLE, impl::handle_done, priv.get());
+
+    LOGD("Started worker pool with ", nr_threads, " threads");
+}
+
+wf::worker_pool_t::~worker_pool_t()
+{
+    {
+        std::lock_guard<std::mutex> lock(priv->mutex);
+        priv->stopping = true;
+    }
+
+    priv->has_jobs.notify_all();
+    for (auto& thread : priv->threads)
+    {
+        thread.join();
+    }
+
+    /* The event source is freed together with the event loop, which has
+     * already been destroyed when the pool is destroyed at exit. */
+    close(priv->done_fd);
+}
+
+int wf::worker_pool_t::get_concurrency() const
+{
+    return priv->threads.size() + 1;
+}
+
+size_t wf::worker_pool_t::parallel_for(size_t count, size_t min_chunk,
+    range_func_t func, uint32_t deadline)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    /* Give each thread a few chunks, so that the load is balanced even if
+     * some threads are busy with other jobs */
+    const size_t nr_target_chunks = 4 * get_concurrency();
+    const size_t chunk_size = std::max({(size_t)1, min_chunk,
+        (count + nr_target_chunks - 1) / nr_target_chunks});
+
+    auto batch = std::make_shared<batch_t>();
+    batch->func       = std::move(func);
+    batch->count      = count;
+    batch->chunk_size = chunk_size;
+    batch->nr_chunks  = (count + chunk_size - 1) / chunk_size;
+    batch->deadline   = deadline;
+
+    const size_t nr_helpers =
+        std::min(batch->nr_chunks - 1, priv->threads.size());
+    for (size_t i = 0; i < nr_helpers; i++)
+    {
+        priv->push_job([batch] ()
+        {
+            while (batch->run_next_chunk())
+            {}
+        });
+    }
+
+    while (batch->run_next_chunk())
+    {}
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&]
+    {
+        return batch->done_chunks == batch->nr_chunks;
+    });
+
+    return batch->processed;
+}
+
+void wf::worker_pool_t::submit(std::function<void()> job,
+    std::function<void()> on_done, const void *owner)
+{
+    if (!on_done && !owner)
+    {
+        priv->push_job(std::move(job));
+        return;
+    }
+
+    auto self = priv.get();
+    if (owner)
+    {
+        std::lock_guard<std::mutex> lock(self->done_mutex);
+        self->owner_jobs[owner]++;
+    }
+
+    priv->push_job([self, owner, job = std::move(job),
+                    on_done = std::move(on_done)] () mutable
+    {
+        job();
+        /* Destroy the job before it counts as finished, so that its captures
+         * are gone when drain() returns */
+        job = nullptr;
+
+        const bool has_callback = (bool)on_done;
+        {
+            std::lock_guard<std::mutex> lock(self->done_mutex);
+            if (has_callback)
+            {
+                self->done_callbacks.push_back({owner, std::move(on_done)});
+            }
+
+            if (owner && (--self->owner_jobs[owner] == 0))
+            {
+                self->owner_jobs.erase(owner);
+                self->owner_done.notify_all();
+            }
+        }
+
+        if (!has_callback)
+        {
+            return;
+        }
+
+        uint64_t one = 1;
+        if (write(self->done_fd, &one, sizeof(one)) < 0)
+        {
+            LOGE("Failed to notify the compositor thread of a finished job");
+        }
+    });
+}
+
+void wf::worker_pool_t::drain(const void *owner)
+{
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::unique_lock<std::mutex> lock(priv->done_mutex);
+        priv->owner_done.wait(lock, [&] { return !priv->owner_jobs.count(owner); });
+
+        auto& pending = priv->done_callbacks;
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            if (it->first == owner)
+            {
+                callbacks.push_back(std::move(it->second));
+                it = pending.erase(it);
+            } else
+            {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& cb : callbacks)
+    {
+        cb();
+    }
+}
@@ -1,12 +1,20 @@
 #include <vector>
 #include "wayfire/debug.hpp"
 #include <string>
+#include <map>
+#include <set>
+#include <sstream>
 #include <wayfire/config/file.hpp>
 #include <wayfire/config-backend.hpp>
 #include <wayfire/plugin.hpp>
 #include <wayfire/core.hpp>
+#include <wayfire/util.hpp>
+#include <wayfire/worker-pool.hpp>
+#include <wayfire/signal-definitions.hpp>
 
 #include <sys/inotify.h>
+#include <sys/file.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #define INOT_BUF_SIZE (sizeof(inotify_event) + NAME_MAX + 1)
@@ -22,65 +30,136 @@ static void readd_watch(int fd)
     wd_cfg_file = inotify_add_watch(fd, config_file.c_str(), IN_MODIFY);
 }
 
-static void reload_config(int fd)
-{
-    wf::config::load_configuration_options_from_file(*cfg_manager, config_file);
-    readd_watch(fd);
-}
+/**
+ * The contents of the config file, split by section, without comments, blank
+ * lines and surrounding whitespace. Used to find out cheaply whether a write
+ * to the file changed anything at all.
+ */
+using config_sections_t = std::map<std::string, std::string>;
 
-static int handle_config_updated(int fd, uint32_t mask, void *data)
+static config_sections_t split_sections(const std::string& source)
 {
-    if ((mask & WL_EVENT_READABLE) == 0)
+    config_sections_t sections;
+    std::string *current = &sections[""];
+
+    std::istringstream stream{source};
+    std::string line;
+    while (std::getline(stream, line))
     {
-        return 0;
+        auto start = line.find_first_not_of(" \t");
+        auto end   = line.find_last_not_of(" \t\r");
+        if ((start == std::string::npos) || (line[start] == '#'))
+        {
+            continue;
+        }
+
+        line = line.substr(start, end - start + 1);
+        if ((line.front() == '[') && (line.back() == ']'))
+        {
+            current = &sections[line.substr(1, line.size() - 2)];
+            continue;
+        }
+
+        current->append(line);
+        current->push_back('\n');
     }
 
-    char buf[INOT_BUF_SIZE] __attribute__((aligned(alignof(inotify_event))));
+    return sections;
+}
 
-    bool should_reload = false;
-    inotify_event *event;
+struct loaded_config_t
+{
+    bool valid = false;
+    std::string contents;
+    config_sections_t sections;
+};
 
-    // Reading from the inotify FD is guaranteed to not read partial events.
-    // From inotify(7):
-    // Each successful read(2) returns a buffer containing
-    // one or more [..] structures
-    auto len = read(fd, buf, INOT_BUF_SIZE);
-    if (len < 0)
+/**
+ * Read and split the config file. Only touches its arguments, so it can run on
+ * a worker thread.
+ */
+static loaded_config_t read_config_file(const std::string& file)
+{
+    loaded_config_t result;
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
     {
-        return 0;
+        return result;
     }
 
-    const auto last_slash = config_file.find_last_of('/');
-    const auto cfg_file_basename = (last_slash == std::string::npos) ?
-        config_file : config_file.substr(last_slash);
+    /* Wait for other writers which lock the file, for ex. wf-config itself */
+    flock(fd, LOCK_SH);
 
-    for (char *ptr = buf;
-         ptr < (buf + len);
-         ptr += sizeof(inotify_event) + event->len)
+    char buf[4096];
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) > 0)
     {
-        event = reinterpret_cast<inotify_event*>(ptr);
-        // We reload in two main cases:
-        //
-        // - Config file itself was modified
-        // - Config file was created inside parent directory
-        should_reload |=
-            (event->wd == wd_cfg_file) || (cfg_file_basename == event->name);
+        result.contents.append(buf, len);
     }
 
-    if (should_reload)
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    result.valid    = (len == 0);
+    result.sections = split_sections(result.contents);
+    return result;
+}
+
+/** The value of each option, by section and option name. */
+using option_values_t =
+    std::map<std::pair<std::string, std::string>, std::string>;
+
+static option_values_t get_option_values(wf::config::config_manager_t& config)
+{
+    option_values_t values;
+    for (auto& section : config.get_all_sections())
     {
-        LOGD("Reloading configuration file");
+        for (auto& option : section->get_registered_options())
+        {
+            values[{section->get_name(), option->get_name()}] =
+                option->get_value_str();
+        }
+    }
+
+    return values;
+}
 
-        reload_config(fd);
-        wf::get_core().emit_signal("reload-config", nullptr);
-    } else
+/** Find the sections where options were added, removed or changed. */
+static std::set<std::string> diff_option_values(const option_values_t& before,
+    const option_values_t& after)
+{
+    std::set<std::string> changed;
+    auto it_before = before.begin();
+    auto it_after  = after.begin();
+    while ((it_before != before.end()) || (it_after != after.end()))
     {
-        readd_watch(fd);
+        if ((it_after == after.end()) ||
+            ((it_before != before.end()) && (it_before->first < it_after->first)))
+        {
+            changed.insert(it_before->first.first);
+            ++it_before;
+        } else if ((it_before == before.end()) ||
+                   (it_after->first < it_before->first))
+        {
+            changed.insert(it_after->first.first);
+            ++it_after;
+        } else
+        {
+            if (it_before->second != it_after->second)
+            {
+                changed.insert(it_before->first.first);
+            }
+
+            ++it_before;
+            ++it_after;
+        }
     }
 
-    return 0;
+    return changed;
 }
 
+static int handle_config_updated(int fd, uint32_t mask, void *data);
+
 static const char *CONFIG_FILE_ENV = "WAYFIRE_CONFIG_FILE";
 
 namespace wf
@@ -100,11 +179,29 @@ class dynamic_ini_config_t : public wf::config_backend_t
         config = wf::config::build_configuration(
             get_xml_dirs(), SYSCONFDIR "/wayfire/defaults.ini", config_file);
 
+        /* build_configuration() already loaded the file, we only remember
+         * what it contained to compare it with later versions. */
+        applied_sections = read_config_file(config_file).sections;
+
         int inotify_fd = inotify_init1(IN_CLOEXEC);
-        reload_config(inotify_fd);
+        readd_watch(inotify_fd);
 
         wl_event_loop_add_fd(wl_display_get_event_loop(display),
-            inotify_fd, WL_EVENT_READABLE, handle_config_updated, NULL);
+            inotify_fd, WL_EVENT_READABLE, handle_config_updated, this);
+    }
+
+    /**
+     * Reload the config file once it has not been written to for
+     * RELOAD_DELAY_MS, because editors often write it in several steps.
+     */
+    void schedule_reload()
+    {
+        reload_timer.disconnect();
+        reload_timer.set_timeout(RELOAD_DELAY_MS, [=] ()
+        {
+            start_reload();
+            return false;
+        });
     }
 
     std::string choose_cfg_file(const std::string& cmdline_cfg_file)
@@ -136,7 +233,114 @@ class dynamic_ini_config_t : public wf::config_backend_t
 
         return config_dir + "/wayfire.ini";
     }
+
+  private:
+    static constexpr int RELOAD_DELAY_MS = 100;
+    wf::wl_timer reload_timer;
+
+    /* Identifies the latest read of the file, older reads are dropped */
+    uint64_t reload_serial = 0;
+    config_sections_t applied_sections;
+
+    /** Read the config file on a worker thread, then apply it. */
+    void start_reload()
+    {
+        auto serial = ++reload_serial;
+        auto loaded = std::make_shared<loaded_config_t>();
+        std::string file = config_file;
+
+        wf::worker_pool_t::get().submit([=] ()
+        {
+            *loaded = read_config_file(file);
+        }, [=] ()
+        {
+            if (serial == reload_serial)
+            {
+                apply_config(*loaded);
+            }
+        });
+    }
+
+    void apply_config(const loaded_config_t& loaded)
+    {
+        if (!loaded.valid)
+        {
+            LOGE("Failed to read config file ", config_file);
+            return;
+        }
+
+        if (loaded.sections == applied_sections)
+        {
+            LOGD("Config file written, but no options were changed");
+            return;
+        }
+
+        LOGD("Reloading configuration file");
+        applied_sections = loaded.sections;
+
+        /* Options notify their updated handlers only when their value
+         * changes, so only the changed options are applied. */
+        auto before = get_option_values(*cfg_manager);
+        wf::config::load_configuration_options_from_string(*cfg_manager,
+            loaded.contents, config_file);
+
+        wf::reload_config_signal data;
+        data.changed_sections =
+            diff_option_values(before, get_option_values(*cfg_manager));
+        if (!data.changed_sections.empty())
+        {
+            wf::get_core().emit_signal("reload-config", &data);
+        }
+    }
 };
 }
 
+static int handle_config_updated(int fd, uint32_t mask, void *data)
+{
+    if ((mask & WL_EVENT_READABLE) == 0)
+    {
+        return 0;
+    }
+
+    char buf[INOT_BUF_SIZE] __attribute__((aligned(alignof(inotify_event))));
+
+    bool should_reload = false;
+    inotify_event *event;
+
+    // Reading from the inotify FD is guaranteed to not read partial events.
+    // From inotify(7):
+    // Each successful read(2) returns a buffer containing
+    // one or more [..] structures
+    auto len = read(fd, buf, INOT_BUF_SIZE);
+    if (len < 0)
+    {
+        return 0;
+    }
+
+    const auto last_slash = config_file.find_last_of('/');
+    const auto cfg_file_basename = (last_slash == std::string::npos) ?
+        config_file : config_file.substr(last_slash);
+
+    for (char *ptr = buf;
+         ptr < (buf + len);
+         ptr += sizeof(inotify_event) + event->len)
+    {
+        event = reinterpret_cast<inotify_event*>(ptr);
+        // We reload in two main cases:
+        //
+        // - Config file itself was modified
+        // - Config file was created inside parent directory
+        should_reload |=
+            (event->wd == wd_cfg_file) || (cfg_file_basename == event->name);
+    }
+
+    readd_watch(fd);
+    if (should_reload)
+    {
+        static_cast<wf::dynamic_ini_config_t*>(data)->schedule_reload();
+    }
+
+    return 0;
+}
+
 DECLARE_WAYFIRE_CONFIG_BACKEND(wf::dynamic_ini_config_t);
@@ -1,6 +1,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <sstream>
+#include <fstream>
 #include <getopt.h>
 #include <signal.h>
 #include <map>
@@ -16,6 +18,12 @@
 #include "output/plugin-loader.hpp"
 #include "core/core-impl.hpp"
 #include "wayfire/output.hpp"
+#include "wayfire/output-layout.hpp"
+#include "output/output-impl.hpp"
+#include "view/view-impl.hpp"
+#include "wayfire/transaction/transaction.hpp"
+#include "wayfire/opengl.hpp"
+#include "core/startup-profiler.hpp"
 
 static void print_version()
 {
@@ -37,6 +45,8 @@ static void print_help()
         " -D,  --damage-debug      enable additional debug for damaged regions" <<
         std::endl;
     std::cout << " -R,  --damage-rerender   rerender damaged regions" << std::endl;
+    std::cout << " -P,  --profile-startup   log how long each startup stage takes" <<
+        std::endl;
     std::cout << " -v,  --version           print version and exit" << std::endl;
     exit(0);
 }
@@ -136,6 +146,55 @@ static void signal_handler(int signal)
 
 #endif
 
+/* Write the recorded frames of each output as a Chrome trace */
+static void dump_frame_traces()
+{
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    for (auto& wo : wf::get_core().output_layout->get_outputs())
+    {
+        auto& profiler = ((wf::output_impl_t*)wo)->get_frame_profiler();
+        if (!profiler.is_enabled())
+        {
+            continue;
+        }
+
+        std::string path = std::string(dir ? dir : "/tmp") +
+            "/wayfire-frames-" + wo->to_string() + ".json";
+        std::ofstream out{path};
+        profiler.write_chrome_trace(out);
+        LOGI("Wrote frame trace of ", wo->to_string(), " to ", path);
+    }
+}
+
+static void log_program_cache_stats()
+{
+    auto programs = OpenGL::get_program_cache_stats();
+    LOGI("GL programs: ", programs.compiled, " compiled in ",
+        programs.compile_us / 1000.0, " ms, ", programs.loaded,
+        " loaded from the cache in ", programs.load_us / 1000.0, " ms");
+}
+
+/* Dump debugging statistics to the log on SIGUSR1 */
+static int handle_dump_stats(int signal, void *data)
+{
+    std::ostringstream out;
+    wf::txn::transaction_manager_t::get().dump_stats(out);
+    LOGI("Transaction statistics:\n", out.str());
+
+    auto pool = OpenGL::get_texture_pool_stats();
+    LOGI("Texture pool: ", pool.allocations, " allocations, ", pool.hits,
+        " hits, ", pool.evictions, " evictions, ", pool.resident_bytes,
+        " bytes resident (", pool.idle_bytes, " idle)");
+
+    auto layer_shell = wf::get_layer_shell_stats();
+    LOGI("Layer-shell: ", layer_shell.requests, " arrange requests, ",
+        layer_shell.unchanged, " unchanged, ", layer_shell.coalesced,
+        " coalesced, ", layer_shell.passes, " passes");
+    log_program_cache_stats();
+    dump_frame_traces();
+    return 0;
+}
+
 static std::optional<std::string> choose_socket(wl_display *display)
 {
     for (int i = 1; i <= 32; i++)
@@ -208,6 +267,7 @@ int main(int argc, char *argv[])
         {"debug", optional_argument, NULL, 'd'},
         {"damage-debug", no_argument, NULL, 'D'},
         {"damage-rerender", no_argument, NULL, 'R'},
+        {"profile-startup", no_argument, NULL, 'P'},
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
         {0, 0, NULL, 0}
@@ -218,7 +278,7 @@ int main(int argc, char *argv[])
     std::vector<std::string> extended_debug_categories;
 
     int c, i;
-    while ((c = getopt_long(argc, argv, "c:B:d::DhRv", opts, &i)) != -1)
+    while ((c = getopt_long(argc, argv, "c:B:d::DhRPv", opts, &i)) != -1)
     {
         switch (c)
         {
@@ -238,6 +298,10 @@ int main(int argc, char *argv[])
             runtime_config.no_damage_track = true;
             break;
 
+          case 'P':
+            wf::startup_profiler_t::get().enable();
+            break;
+
           case 'h':
             print_help();
             break;
@@ -333,7 +397,15 @@ int main(int argc, char *argv[])
 
     LOGD("Using configuration backend: ", config_backend);
     core.config_backend = std::unique_ptr<wf::config_backend_t>(backend);
-    core.config_backend->init(display, core.config, config_file);
+    {
+        wf::startup_profiler_t::scope_t scope{"config"};
+        core.config_backend->init(display, core.config, config_file);
+    }
+
+    /* Block SIGUSR1 before core.init() starts any thread, so that the threads
+     * inherit the blocked signal. It is handled only once the event loop runs,
+     * after the initialization. */
+    wl_event_loop_add_signal(core.ev_loop, SIGUSR1, handle_dump_stats, nullptr);
     core.init();
 
     auto socket = choose_socket(core.display);
@@ -346,7 +418,14 @@ int main(int argc, char *argv[])
 
     core.wayland_display = socket.value();
     LOGI("Using socket name ", core.wayland_display);
-    if (!wlr_backend_start(core.backend))
+    bool backend_started;
+    {
+        /* Creates the outputs, which load their plugins, and input devices */
+        wf::startup_profiler_t::scope_t scope{"backend-start"};
+        backend_started = wlr_backend_start(core.backend);
+    }
+
+    if (!backend_started)
     {
         LOGE("Failed to initialize backend, exiting");
         wlr_backend_destroy(core.backend);
@@ -356,7 +435,17 @@ int main(int argc, char *argv[])
     }
 
     setenv("WAYLAND_DISPLAY", core.wayland_display.c_str(), 1);
-    core.post_init();
+    {
+        wf::startup_profiler_t::scope_t scope{"post-init"};
+        core.post_init();
+    }
+
+    /* The programs of the core and of the plugins of the initial outputs */
+    log_program_cache_stats();
+    wl_event_loop_add_idle(core.ev_loop, [] (void*)
+    {
+        wf::startup_profiler_t::get().finish();
+    }, nullptr);
 
     wl_display_run(core.display);
 
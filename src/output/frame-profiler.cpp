@@ -0,0 +1,250 @@
+#include "frame-profiler.hpp"
+#include "../core/chrome-trace.hpp"
+#include <wayfire/output.hpp>
+#include <wayfire/opengl.hpp>
+#include <wayfire/util/log.hpp>
+
+#include <GLES2/gl2ext.h>
+#include <EGL/egl.h>
+#include <cstring>
+#include <cxxabi.h>
+
+namespace
+{
+PFNGLGENQUERIESEXTPROC gen_queries;
+PFNGLDELETEQUERIESEXTPROC delete_queries;
+PFNGLBEGINQUERYEXTPROC begin_query;
+PFNGLENDQUERYEXTPROC end_query;
+PFNGLGETQUERYOBJECTUIVEXTPROC get_query_uiv;
+PFNGLGETQUERYOBJECTUI64VEXTPROC get_query_ui64v;
+}
+
+wf::frame_profiler_t::frame_profiler_t(wf::output_t *output)
+{
+    this->output = output;
+}
+
+wf::frame_profiler_t::~frame_profiler_t()
+{
+    if (!gpu_supported)
+    {
+        return;
+    }
+
+    OpenGL::render_begin();
+    for (auto& q : gpu_queries)
+    {
+        delete_queries(1, &q.query);
+    }
+
+    OpenGL::render_end();
+}
+
+void wf::frame_profiler_t::push_event(const char *name, name_t hook_name,
+    uint32_t frame, bool gpu, int64_t start, int64_t duration)
+{
+    if (events.empty())
+    {
+        events.resize(MAX_EVENTS);
+    }
+
+    events[nr_events % MAX_EVENTS] =
+    {name, std::move(hook_name), frame, gpu, start, duration};
+    ++nr_events;
+}
+
+void wf::frame_profiler_t::begin_frame()
+{
+    ++frame;
+}
+
+wf::frame_profiler_t::scope_t::scope_t(frame_profiler_t *profiler,
+    const char *name)
+{
+    this->profiler = (profiler && profiler->is_enabled()) ? profiler : nullptr;
+    this->name     = name;
+    this->start    = this->profiler ? trace_now_us() : 0;
+}
+
+wf::frame_profiler_t::scope_t::scope_t(frame_profiler_t *profiler,
+    name_t hook_name) : scope_t(profiler, hook_name ? hook_name->c_str() : "")
+{
+    this->hook_name = std::move(hook_name);
+}
+
+wf::frame_profiler_t::scope_t::~scope_t()
+{
+    if (profiler)
+    {
+        profiler->push_event(name, std::move(hook_name), profiler->frame, false,
+            start, trace_now_us() - start);
+    }
+}
+
+wf::frame_profiler_t::name_t wf::frame_profiler_t::get_hook_name(
+    const void *hook, const std::type_info& type)
+{
+    auto it = hook_names.find(hook);
+    if (it != hook_names.end())
+    {
+        return it->second;
+    }
+
+    int status;
+    char *demangled = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+    auto name = std::make_shared<const std::string>(
+        (status == 0) ? demangled : type.name());
+    free(demangled);
+
+    hook_names[hook] = name;
+    return name;
+}
+
+void wf::frame_profiler_t::forget_hook(const void *hook)
+{
+    hook_names.erase(hook);
+}
+
+void wf::frame_profiler_t::init_gpu_queries()
+{
+    gpu_checked = true;
+
+    auto extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "GL_EXT_disjoint_timer_query"))
+    {
+        LOGI("GPU frame times are not available on ", output->to_string());
+        return;
+    }
+
+    gen_queries    = (PFNGLGENQUERIESEXTPROC)eglGetProcAddress("glGenQueriesEXT");
+    delete_queries =
+        (PFNGLDELETEQUERIESEXTPROC)eglGetProcAddress("glDeleteQueriesEXT");
+    begin_query = (PFNGLBEGINQUERYEXTPROC)eglGetProcAddress("glBeginQueryEXT");
+    end_query   = (PFNGLENDQUERYEXTPROC)eglGetProcAddress("glEndQueryEXT");
+    get_query_uiv = (PFNGLGETQUERYOBJECTUIVEXTPROC)eglGetProcAddress(
+        "glGetQueryObjectuivEXT");
+    get_query_ui64v = (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress(
+        "glGetQueryObjectui64vEXT");
+
+    if (!gen_queries || !delete_queries || !begin_query || !end_query ||
+        !get_query_uiv || !get_query_ui64v)
+    {
+        return;
+    }
+
+    for (auto& q : gpu_queries)
+    {
+        gen_queries(1, &q.query);
+    }
+
+    gpu_supported = true;
+}
+
+void wf::frame_profiler_t::set_gpu_time_callback(gpu_time_callback_t callback)
+{
+    this->gpu_time_callback = std::move(callback);
+}
+
+void wf::frame_profiler_t::begin_gpu(bool needed)
+{
+    if (!is_enabled() && !(needed && gpu_time_callback))
+    {
+        return;
+    }
+
+    if (!gpu_checked)
+    {
+        init_gpu_queries();
+    }
+
+    if (!gpu_supported)
+    {
+        return;
+    }
+
+    /* Not in begin_frame(), the GL context may not be current there */
+    collect_gpu_queries();
+
+    auto& q = gpu_queries[next_gpu_query];
+    if (q.in_flight)
+    {
+        /* The GPU is more than MAX_GPU_QUERIES frames behind, skip this frame */
+        return;
+    }
+
+    next_gpu_query    = (next_gpu_query + 1) % MAX_GPU_QUERIES;
+    q.frame = frame;
+    q.cpu_start = trace_now_us();
+    q.in_flight = true;
+    begin_query(GL_TIME_ELAPSED_EXT, q.query);
+    active_gpu_query = &q;
+}
+
+void wf::frame_profiler_t::end_gpu()
+{
+    if (active_gpu_query)
+    {
+        end_query(GL_TIME_ELAPSED_EXT);
+        active_gpu_query = nullptr;
+    }
+}
+
+void wf::frame_profiler_t::collect_gpu_queries()
+{
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+    for (auto& q : gpu_queries)
+    {
+        if (!q.in_flight)
+        {
+            continue;
+        }
+
+        GLuint available = 0;
+        get_query_uiv(q.query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+        if (!available)
+        {
+            continue;
+        }
+
+        GLuint64 elapsed_ns = 0;
+        get_query_ui64v(q.query, GL_QUERY_RESULT_EXT, &elapsed_ns);
+        q.in_flight = false;
+
+        /* Results are meaningless if the GPU has been reset, throttled, etc. */
+        if (disjoint)
+        {
+            continue;
+        }
+
+        if (is_enabled())
+        {
+            push_event("gpu", nullptr, q.frame, true, q.cpu_start,
+                elapsed_ns / 1000);
+        }
+
+        if (gpu_time_callback)
+        {
+            gpu_time_callback(q.frame, elapsed_ns / 1000);
+        }
+    }
+}
+
+void wf::frame_profiler_t::write_chrome_trace(std::ostream& out) const
+{
+    const uint64_t end   = nr_events;
+    const uint64_t begin = (end > MAX_EVENTS) ? end - MAX_EVENTS : 0;
+    const auto tid = output->get_id();
+
+    chrome_trace_writer_t trace{out};
+    trace.thread_name(tid, output->to_string());
+    for (uint64_t i = begin; i < end; i++)
+    {
+        const auto& ev = events[i % MAX_EVENTS];
+        trace.complete_event(ev.name, ev.gpu ? "gpu" : "cpu", tid, ev.start,
+            ev.duration, ev.frame);
+    }
+
+    trace.finish();
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <wayfire/option-wrapper.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace wf
+{
+class output_t;
+
+/**
+ * Records the CPU time spent in each phase of the frames of an output, in each
+ * effect and post hook, and the GPU time of the frames, so that missed frames
+ * can be attributed to a phase or to the plugin which added a hook.
+ *
+ * The last events are kept in a fixed-size ring buffer, which can be exported
+ * in the Chrome trace format (chrome://tracing, Perfetto) at any time. Nothing
+ * is recorded unless the core/frame_profiler option is enabled.
+ */
+class frame_profiler_t
+{
+  public:
+    frame_profiler_t(wf::output_t *output);
+    ~frame_profiler_t();
+
+    frame_profiler_t(const frame_profiler_t &) = delete;
+    frame_profiler_t(frame_profiler_t &&) = delete;
+    frame_profiler_t& operator =(const frame_profiler_t&) = delete;
+    frame_profiler_t& operator =(frame_profiler_t&&) = delete;
+
+    /** Whether events are being recorded. */
+    bool is_enabled() const
+    {
+        return enabled;
+    }
+
+    /** Mark the start of a new frame. */
+    void begin_frame();
+
+    /**
+     * Start measuring the GPU time of the frame. Must be called with the GL
+     * context current, and be followed by end_gpu() in the same frame.
+     *
+     * @param needed Whether the time is needed by the GPU time callback, in
+     *   which case it is measured even if recording is disabled.
+     */
+    void begin_gpu(bool needed = false);
+    void end_gpu();
+
+    /** The number of the current frame, counted by begin_frame(). */
+    uint32_t get_frame() const
+    {
+        return frame;
+    }
+
+    /** Whether GPU times are measured. Known after the first begin_gpu(). */
+    bool has_gpu_times() const
+    {
+        return gpu_supported;
+    }
+
+    using gpu_time_callback_t =
+        std::function<void (uint32_t frame, int64_t usec)>;
+
+    /**
+     * Set a function which receives the GPU time of each measured frame. The
+     * time of a frame is known only a few frames after it was rendered.
+     */
+    void set_gpu_time_callback(gpu_time_callback_t callback);
+
+    using name_t = std::shared_ptr<const std::string>;
+
+    /**
+     * Records the CPU time between its creation and destruction.
+     * A plain name must be valid until the profiler is destroyed, for ex. a
+     * string literal. The profiler may be null, in which case nothing is
+     * recorded.
+     */
+    class scope_t
+    {
+      public:
+        scope_t(frame_profiler_t *profiler, const char *name);
+        /** Record a hook, with a name returned by get_hook_name(). */
+        scope_t(frame_profiler_t *profiler, name_t hook_name);
+        ~scope_t();
+
+        scope_t(const scope_t &) = delete;
+        scope_t& operator =(const scope_t&) = delete;
+
+      private:
+        frame_profiler_t *profiler;
+        const char *name;
+        name_t hook_name;
+        int64_t start;
+    };
+
+    /**
+     * Get a readable name for a hook, derived from the type of the callable
+     * it wraps. For lambdas, it contains the class of the plugin which
+     * defines it.
+     *
+     * The name is a copy, so recorded events stay valid after the plugin
+     * which added the hook is unloaded.
+     */
+    name_t get_hook_name(const void *hook, const std::type_info& type);
+
+    /** Drop the name of a hook which was removed from the output. */
+    void forget_hook(const void *hook);
+
+    /**
+     * Write all recorded events as a Chrome trace JSON document.
+     */
+    void write_chrome_trace(std::ostream& out) const;
+
+  private:
+    wf::output_t *output;
+
+    wf::option_wrapper_t<bool> enabled{"core/frame_profiler"};
+
+    struct event_t
+    {
+        const char *name;
+        /* Keeps the name of a hook alive while the event is recorded */
+        name_t hook_name;
+        uint32_t frame;
+        bool gpu;
+        /* Microseconds, relative to the steady clock epoch */
+        int64_t start;
+        int64_t duration;
+    };
+
+    static constexpr size_t MAX_EVENTS = 8192;
+    /* Events are written and read only on the compositor thread */
+    std::vector<event_t> events;
+    uint64_t nr_events = 0;
+    uint32_t frame = 0;
+
+    void push_event(const char *name, name_t hook_name, uint32_t frame,
+        bool gpu, int64_t start, int64_t duration);
+
+    std::unordered_map<const void*, name_t> hook_names;
+
+    /* GPU timer queries, if GL_EXT_disjoint_timer_query is available */
+    struct gpu_query_t
+    {
+        uint32_t query = 0;
+        uint32_t frame = 0;
+        int64_t cpu_start = 0;
+        bool in_flight = false;
+    };
+
+    static constexpr size_t MAX_GPU_QUERIES = 4;
+    gpu_query_t gpu_queries[MAX_GPU_QUERIES];
+    size_t next_gpu_query = 0;
+    gpu_query_t *active_gpu_query = nullptr;
+    bool gpu_checked = false;
+    bool gpu_supported = false;
+    gpu_time_callback_t gpu_time_callback;
+
+    void init_gpu_queries();
+    void collect_gpu_queries();
+};
+}
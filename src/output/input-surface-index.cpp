@@ -0,0 +1,205 @@
+#include "input-surface-index.hpp"
+#include <wayfire/output.hpp>
+#include <wayfire/signal-definitions.hpp>
+#include <wayfire/workspace-manager.hpp>
+#include <algorithm>
+
+wf::input_surface_index_t::input_surface_index_t(wf::output_t *output)
+{
+    this->output = output;
+    this->cells.resize(GRID_SIZE * GRID_SIZE);
+
+    on_view_geometry_changed.set_callback([=] (wf::signal_data_t *data)
+    {
+        if (dirty)
+        {
+            return;
+        }
+
+        auto it = entry_index.find(get_signaled_view(data).get());
+        if ((it == entry_index.end()) || entries[it->second].transformed)
+        {
+            return;
+        }
+
+        remove_from_cells(it->second);
+        entries[it->second].bbox = get_input_bbox(entries[it->second].view.get());
+        add_to_cells(it->second);
+    });
+    output->connect_signal("view-geometry-changed", &on_view_geometry_changed);
+
+    /* Also invalidated when views disappear or are detached, so that we never
+     * keep a pointer to a view which is gone */
+    on_views_changed.set_callback([=] (wf::signal_data_t*)
+    {
+        dirty = true;
+    });
+    for (auto signal : {"view-mapped", "view-disappeared", "view-minimized",
+        "view-attached", "view-detached", "view-layer-attached",
+        "view-layer-detached", "view-change-workspace",
+        "view-transformer-changed", "stack-order-changed", "workspace-changed",
+        "output-configuration-changed"})
+    {
+        output->connect_signal(signal, &on_views_changed);
+    }
+}
+
+wf::geometry_t wf::input_surface_index_t::get_input_bbox(
+    wf::view_interface_t *view)
+{
+    /* Grow the box a bit, so that it surely contains the input region even if
+     * the transformed geometry was rounded */
+    auto bbox = view->get_bounding_box();
+    bbox.x     -= 1;
+    bbox.y     -= 1;
+    bbox.width += 2;
+    bbox.height += 2;
+
+    return bbox;
+}
+
+bool wf::input_surface_index_t::get_cell_range(const wf::geometry_t& box,
+    int& x1, int& y1, int& x2, int& y2) const
+{
+    auto visible = wf::geometry_intersection(box, output_geometry);
+    if ((visible.width <= 0) || (visible.height <= 0))
+    {
+        return false;
+    }
+
+    x1 = visible.x / cell_size.width;
+    y1 = visible.y / cell_size.height;
+    x2 = std::min((visible.x + visible.width - 1) / cell_size.width,
+        GRID_SIZE - 1);
+    y2 = std::min((visible.y + visible.height - 1) / cell_size.height,
+        GRID_SIZE - 1);
+
+    return true;
+}
+
+void wf::input_surface_index_t::add_to_cells(uint32_t idx)
+{
+    int x1, y1, x2, y2;
+    if (!get_cell_range(entries[idx].bbox, x1, y1, x2, y2))
+    {
+        return;
+    }
+
+    for (int i = y1; i <= y2; i++)
+    {
+        for (int j = x1; j <= x2; j++)
+        {
+            auto& cell = cells[i * GRID_SIZE + j];
+            cell.insert(std::lower_bound(cell.begin(), cell.end(), idx), idx);
+        }
+    }
+}
+
+void wf::input_surface_index_t::remove_from_cells(uint32_t idx)
+{
+    int x1, y1, x2, y2;
+    if (!get_cell_range(entries[idx].bbox, x1, y1, x2, y2))
+    {
+        return;
+    }
+
+    for (int i = y1; i <= y2; i++)
+    {
+        for (int j = x1; j <= x2; j++)
+        {
+            auto& cell = cells[i * GRID_SIZE + j];
+            auto it    = std::lower_bound(cell.begin(), cell.end(), idx);
+            if ((it != cell.end()) && (*it == idx))
+            {
+                cell.erase(it);
+            }
+        }
+    }
+}
+
+void wf::input_surface_index_t::rebuild()
+{
+    entries.clear();
+    entry_index.clear();
+    transformed.clear();
+    for (auto& cell : cells)
+    {
+        cell.clear();
+    }
+
+    output_geometry = output->get_relative_geometry();
+    cell_size.width =
+        std::max(1, (output_geometry.width + GRID_SIZE - 1) / GRID_SIZE);
+    cell_size.height =
+        std::max(1, (output_geometry.height + GRID_SIZE - 1) / GRID_SIZE);
+
+    /* Views outside of the output are kept too, so that they can be added
+     * to the grid when they are moved onto it */
+    for (auto& v : output->workspace->get_views_in_layer(wf::VISIBLE_LAYERS))
+    {
+        for (auto& view : v->enumerate_views())
+        {
+            const uint32_t idx = entries.size();
+            entries.push_back({view, get_input_bbox(view.get()),
+                view->has_transformer()});
+            entry_index[view.get()] = idx;
+
+            if (entries.back().transformed)
+            {
+                transformed.push_back(idx);
+            } else
+            {
+                add_to_cells(idx);
+            }
+        }
+    }
+
+    dirty = false;
+}
+
+wf::surface_interface_t*wf::input_surface_index_t::input_surface_at(
+    wf::pointf_t point, wf::pointf_t& local, const view_filter_t& filter)
+{
+    if (dirty)
+    {
+        rebuild();
+    }
+
+    /* The point may be slightly outside of the output because of rounding */
+    int i = std::clamp((int)(point.y / cell_size.height), 0, GRID_SIZE - 1);
+    int j = std::clamp((int)(point.x / cell_size.width), 0, GRID_SIZE - 1);
+    auto& cell = cells[i * GRID_SIZE + j];
+
+    /* Merge the views of the cell with the transformed views, both are in
+     * stacking order */
+    size_t next_cell = 0, next_transformed = 0;
+    while ((next_cell < cell.size()) || (next_transformed < transformed.size()))
+    {
+        uint32_t idx;
+        if ((next_transformed == transformed.size()) ||
+            ((next_cell < cell.size()) &&
+             (cell[next_cell] < transformed[next_transformed])))
+        {
+            idx = cell[next_cell++];
+        } else
+        {
+            idx = transformed[next_transformed++];
+        }
+
+        auto& entry = entries[idx];
+        auto bbox   = entry.transformed ?
+            get_input_bbox(entry.view.get()) : entry.bbox;
+        if (!(bbox & point) || !filter(entry.view.get()))
+        {
+            continue;
+        }
+
+        auto surface = entry.view->map_input_coordinates(point, local);
+        if (surface)
+        {
+            return surface;
+        }
+    }
+
+    return nullptr;
+}
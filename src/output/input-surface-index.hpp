@@ -0,0 +1,89 @@
+#pragma once
+
+#include <wayfire/view.hpp>
+#include <wayfire/object.hpp>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace wf
+{
+class output_t;
+
+/**
+ * A spatial index of the views on an output, used for finding the surface
+ * under the cursor without going over all views on each pointer motion.
+ *
+ * The output is divided into a grid of cells, and each cell has a list of the
+ * views whose bounding box intersects it, in stacking order.
+ *
+ * When a view is moved or resized, only its cells are updated. The index is
+ * rebuilt lazily when the set or stacking order of the views changes, i.e
+ * when views are mapped, unmapped, restacked or moved between layers,
+ * workspaces or outputs, which happens much less often.
+ *
+ * Views with transformers are not put in the grid. Their bounding box changes
+ * on each frame of an animation, without any signal, so they are checked on
+ * each query instead.
+ */
+class input_surface_index_t
+{
+  public:
+    input_surface_index_t(wf::output_t *output);
+
+    /** Views for which this returns false are skipped by input_surface_at() */
+    using view_filter_t = std::function<bool (wf::view_interface_t*)>;
+
+    /**
+     * Find the topmost surface which accepts input at the given point.
+     *
+     * @param point The point, in output-local coordinates.
+     * @param local Set to the point in the surface-local coordinates of the
+     *   returned surface.
+     * @param filter Which views to consider.
+     */
+    wf::surface_interface_t *input_surface_at(wf::pointf_t point,
+        wf::pointf_t& local, const view_filter_t& filter);
+
+  private:
+    /* The number of cells in each row and column of the grid */
+    static constexpr int GRID_SIZE = 16;
+
+    wf::output_t *output;
+
+    struct entry_t
+    {
+        wayfire_view view;
+        wf::geometry_t bbox;
+        bool transformed;
+    };
+
+    /* All views on the output, in stacking order */
+    std::vector<entry_t> entries;
+    std::unordered_map<wf::view_interface_t*, uint32_t> entry_index;
+    /* Indices in entries of the views in each cell, in stacking order */
+    std::vector<std::vector<uint32_t>> cells;
+    /* Indices in entries of the views with transformers, in stacking order */
+    std::vector<uint32_t> transformed;
+    wf::geometry_t output_geometry;
+    wf::dimensions_t cell_size;
+
+    bool dirty = true;
+
+    void rebuild();
+
+    static wf::geometry_t get_input_bbox(wf::view_interface_t *view);
+
+    /**
+     * Find the cells which contain the given box.
+     * @return false if the box is outside of the output.
+     */
+    bool get_cell_range(const wf::geometry_t& box,
+        int& x1, int& y1, int& x2, int& y2) const;
+    void add_to_cells(uint32_t idx);
+    void remove_from_cells(uint32_t idx);
+
+    wf::signal_connection_t on_view_geometry_changed;
+    wf::signal_connection_t on_views_changed;
+};
+}
@@ -1,6 +1,8 @@
 #include "wayfire/output.hpp"
 #include "plugin-loader.hpp"
 #include "../core/seat/bindings-repository.hpp"
+#include "input-surface-index.hpp"
+#include "frame-profiler.hpp"
 
 #include <unordered_set>
 #include <wayfire/nonstd/safe-list.hpp>
@@ -13,6 +15,8 @@ class output_impl_t : public output_t
     std::unordered_multiset<wf::plugin_grab_interface_t*> active_plugins;
     std::unique_ptr<plugin_manager> plugin;
     std::unique_ptr<wf::bindings_repository_t> bindings;
+    std::unique_ptr<wf::input_surface_index_t> input_index;
+    std::unique_ptr<wf::frame_profiler_t> profiler;
 
     signal_connection_t view_disappeared_cb;
     bool inhibited = false;
@@ -106,6 +110,12 @@ class output_impl_t : public output_t
     /** @return The bindings repository of the output */
     bindings_repository_t& get_bindings();
 
+    /** @return The index used for finding the surface under the cursor */
+    input_surface_index_t& get_input_surface_index();
+
+    /** @return The profiler which records the frame timings of the output */
+    frame_profiler_t& get_frame_profiler();
+
     /** Set the effective resolution of the output */
     void set_effective_size(const wf::dimensions_t& size);
 };
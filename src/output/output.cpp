@@ -24,7 +24,9 @@ wf::output_impl_t::output_impl_t(wlr_output *handle,
     this->set_effective_size(effective_size);
     this->handle = handle;
     workspace    = std::make_unique<workspace_manager>(this);
+    profiler     = std::make_unique<frame_profiler_t>(this);
     render = std::make_unique<render_manager>(this);
+    input_index = std::make_unique<input_surface_index_t>(this);
 
     view_disappeared_cb.set_callback([=] (wf::signal_data_t *data)
     {
@@ -538,25 +540,32 @@ static wf::binding_t *push_binding(
 binding_t*output_impl_t::add_key(option_sptr_t<keybinding_t> key,
     wf::key_callback *callback)
 {
-    return push_binding(this->bindings->keys, key, callback);
+    auto result = push_binding(this->bindings->keys, key, callback);
+    this->bindings->binding_added(key.get());
+    return result;
 }
 
 binding_t*output_impl_t::add_axis(option_sptr_t<keybinding_t> axis,
     wf::axis_callback *callback)
 {
-    return push_binding(this->bindings->axes, axis, callback);
+    auto result = push_binding(this->bindings->axes, axis, callback);
+    this->bindings->binding_added(axis.get());
+    return result;
 }
 
 binding_t*output_impl_t::add_button(option_sptr_t<buttonbinding_t> button,
     wf::button_callback *callback)
 {
-    return push_binding(this->bindings->buttons, button, callback);
+    auto result = push_binding(this->bindings->buttons, button, callback);
+    this->bindings->binding_added(button.get());
+    return result;
 }
 
 binding_t*output_impl_t::add_activator(
     option_sptr_t<activatorbinding_t> activator, wf::activator_callback *callback)
 {
     auto result = push_binding(this->bindings->activators, activator, callback);
+    this->bindings->binding_added(activator.get());
     this->bindings->recreate_hotspots();
     return result;
 }
@@ -576,6 +585,16 @@ bindings_repository_t& output_impl_t::get_bindings()
     return *bindings;
 }
 
+input_surface_index_t& output_impl_t::get_input_surface_index()
+{
+    return *input_index;
+}
+
+frame_profiler_t& output_impl_t::get_frame_profiler()
+{
+    return *profiler;
+}
+
 bool output_impl_t::call_plugin(
     const std::string& activator, const wf::activator_data_t& data) const
 {
@@ -1,6 +1,7 @@
 #include <sstream>
 #include <algorithm>
 #include <set>
+#include <unordered_map>
 #include <memory>
 #include <filesystem>
 #include <dlfcn.h>
@@ -10,16 +11,61 @@
 #include "wayfire/output.hpp"
 #include "../core/wm.hpp"
 #include "wayfire/core.hpp"
+#include "../core/startup-profiler.hpp"
 #include <wayfire/util/log.hpp>
 
+namespace
+{
+/**
+ * The plugin objects loaded by any output. Each object is opened once and
+ * instantiated for each output, and it is closed when its last instance is
+ * destroyed.
+ */
+struct plugin_object_t
+{
+    void *handle;
+    void *new_instance_func;
+    int instances = 0;
+};
+
+std::unordered_map<std::string, plugin_object_t> plugin_objects;
+
+void release_plugin_object(void *handle)
+{
+    for (auto it = plugin_objects.begin(); it != plugin_objects.end(); ++it)
+    {
+        if ((it->second.handle == handle) && (--it->second.instances == 0))
+        {
+            /* Note that dlclose() is merely a "statement of intent" as per
+             * POSIX[1]:
+             * - On glibc[2], this decreases the reference count and
+             *   potentially unloads the binary.
+             * - On musl-libc[3] this is a noop.
+             *
+             * [1]:
+             * https://pubs.opengroup.org/onlinepubs/9699919799/functions/dlclose.html
+             * [2]: https://man7.org/linux/man-pages/man3/dlclose.3.html
+             * [3]:
+             * https://wiki.musl-libc.org/functional-differences-from-glibc.html#Unloading-libraries
+             * */
+            dlclose(handle);
+            plugin_objects.erase(it);
+            return;
+        }
+    }
+}
+}
 
 plugin_manager::plugin_manager(wf::output_t *o)
 {
     this->output = o;
     this->plugins_opt.load_option("core/plugins");
 
-    reload_dynamic_plugins();
-    load_static_plugins();
+    {
+        wf::startup_profiler_t::scope_t scope{"plugins " + o->to_string()};
+        reload_dynamic_plugins();
+        load_static_plugins();
+    }
 
     this->plugins_opt.set_callback([=] ()
     {
@@ -70,26 +116,11 @@ void plugin_manager::destroy_plugin(wayfire_plugin& p)
     auto handle = p->handle;
     p.reset();
 
-    /* dlopen()/dlclose() do reference counting, so we should close the plugin
-     * as many times as we opened it.
-     *
-     * We also need to close the handle after deallocating the plugin, otherwise
-     * we unload its destructor before calling it.
-     *
-     * Note however, that dlclose() is merely a "statement of intent" as per
-     * POSIX[1]:
-     * - On glibc[2], this decreases the reference count and potentially unloads
-     *   the binary.
-     * - On musl-libc[3] this is a noop.
-     *
-     * [1]: https://pubs.opengroup.org/onlinepubs/9699919799/functions/dlclose.html
-     * [2]: https://man7.org/linux/man-pages/man3/dlclose.3.html
-     * [3]:
-     * https://wiki.musl-libc.org/functional-differences-from-glibc.html#Unloading-libraries
-     * */
+    /* We need to release the object after deallocating the plugin, otherwise
+     * we unload its destructor before calling it. */
     if (handle)
     {
-        dlclose(handle);
+        release_plugin_object(handle);
     }
 }
 
@@ -139,36 +170,47 @@ std::pair<void*, void*> wf::get_new_instance_handle(const std::string& path)
 
 wayfire_plugin plugin_manager::load_plugin_from_file(std::string path)
 {
-    auto [handle, new_instance_func_ptr] = wf::get_new_instance_handle(path);
-
-    if (new_instance_func_ptr)
+    auto it = plugin_objects.find(path);
+    if (it == plugin_objects.end())
     {
-        auto new_instance_func =
-            wf::union_cast<void*, wayfire_plugin_load_func>(new_instance_func_ptr);
-
-        auto ptr = wayfire_plugin(new_instance_func());
-        ptr->handle = handle;
+        wf::startup_profiler_t::scope_t scope{"dlopen " + path};
+        auto [handle, new_instance_func_ptr] = wf::get_new_instance_handle(path);
+        if (!new_instance_func_ptr)
+        {
+            return nullptr;
+        }
 
-        return ptr;
+        it = plugin_objects.emplace(path,
+            plugin_object_t{handle, new_instance_func_ptr}).first;
     }
 
-    return nullptr;
+    auto new_instance_func = wf::union_cast<void*, wayfire_plugin_load_func>(
+        it->second.new_instance_func);
+
+    auto ptr = wayfire_plugin(new_instance_func());
+    ptr->handle = it->second.handle;
+    it->second.instances++;
+
+    return ptr;
 }
 
-void plugin_manager::reload_dynamic_plugins()
+/**
+ * Find the files of the plugins in the list. The files of the last complete
+ * list are kept, so that each output does not search the plugin directories
+ * again.
+ */
+static std::vector<std::string> find_plugin_files(const std::string& plugin_list)
 {
-    std::string plugin_list = plugins_opt;
-    if (plugin_list == "none")
+    static std::string cached_list;
+    static std::vector<std::string> cached_files;
+    if (!cached_list.empty() && (plugin_list == cached_list))
     {
-        LOGE("No plugins specified in the config file, or config file is "
-             "missing. In this state the compositor is nearly unusable, please "
-             "ensure your configuration file is set up properly.");
+        return cached_files;
     }
 
     std::stringstream stream(plugin_list);
     std::vector<std::string> next_plugins;
 
-    auto plugin_prefix = std::string(PLUGIN_PATH "/");
     std::vector<std::string> plugin_prefixes;
     if (char *plugin_path = getenv("WAYFIRE_PLUGIN_PATH"))
     {
@@ -182,6 +224,7 @@ void plugin_manager::reload_dynamic_plugins()
 
     plugin_prefixes.push_back(PLUGIN_PATH);
 
+    bool all_found = true;
     std::string plugin_name;
     while (stream >> plugin_name)
     {
@@ -207,6 +250,7 @@ void plugin_manager::reload_dynamic_plugins()
 
             if (!plugin_found)
             {
+                all_found = false;
                 LOGE("Failed to load plugin \"", plugin_name, "\". ",
                     "Make sure it is installed in ", PLUGIN_PATH,
                     " or in $WAYFIRE_PLUGIN_PATH.");
@@ -214,6 +258,28 @@ void plugin_manager::reload_dynamic_plugins()
         }
     }
 
+    /* Missing plugins may be installed before the next output is created */
+    if (all_found)
+    {
+        cached_list  = plugin_list;
+        cached_files = next_plugins;
+    }
+
+    return next_plugins;
+}
+
+void plugin_manager::reload_dynamic_plugins()
+{
+    std::string plugin_list = plugins_opt;
+    if (plugin_list == "none")
+    {
+        LOGE("No plugins specified in the config file, or config file is "
+             "missing. In this state the compositor is nearly unusable, please "
+             "ensure your configuration file is set up properly.");
+    }
+
+    auto next_plugins = find_plugin_files(plugin_list);
+
     /* erase plugins that have been removed from the config */
     auto it = loaded_plugins.begin();
     while (it != loaded_plugins.end())
@@ -249,6 +315,9 @@ void plugin_manager::reload_dynamic_plugins()
         auto ptr = load_plugin_from_file(plugin);
         if (ptr)
         {
+            wf::startup_profiler_t::scope_t scope{
+                std::filesystem::path(plugin).stem().string() + " init " +
+                output->to_string()};
             init_plugin(ptr);
             loaded_plugins[plugin] = std::move(ptr);
         }
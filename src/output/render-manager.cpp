@@ -9,7 +9,12 @@
 #include "../core/seat/seat.hpp"
 #include "../core/opengl-priv.hpp"
 #include "../main.hpp"
+#include "output-impl.hpp"
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <unordered_set>
 #include <wayfire/nonstd/reverse.hpp>
 #include <wayfire/nonstd/safe-list.hpp>
 #include <wayfire/util/log.hpp>
@@ -234,6 +239,12 @@ struct effect_hook_manager_t
 {
     using effect_container_t = wf::safe_list_t<effect_hook_t*>;
     effect_container_t effects[OUTPUT_EFFECT_TOTAL];
+    frame_profiler_t *profiler;
+
+    effect_hook_manager_t(frame_profiler_t *profiler)
+    {
+        this->profiler = profiler;
+    }
 
     void add_effect(effect_hook_t *hook, output_effect_type_t type)
     {
@@ -252,12 +263,25 @@ struct effect_hook_manager_t
         {
             effects[i].remove_all(hook);
         }
+
+        profiler->forget_hook(hook);
     }
 
     void run_effects(output_effect_type_t type)
     {
-        effects[type].for_each([] (auto effect)
-        { (*effect)(); });
+        if (!profiler->is_enabled())
+        {
+            effects[type].for_each([] (auto effect)
+            { (*effect)(); });
+            return;
+        }
+
+        effects[type].for_each([&] (auto effect)
+        {
+            frame_profiler_t::scope_t scope{profiler,
+                profiler->get_hook_name(effect, effect->target_type())};
+            (*effect)();
+        });
     }
 };
 
@@ -273,10 +297,12 @@ struct postprocessing_manager_t
     static constexpr uint32_t default_out_buffer = 0;
 
     output_t *output;
+    frame_profiler_t *profiler;
     uint32_t output_width, output_height;
-    postprocessing_manager_t(output_t *output)
+    postprocessing_manager_t(output_t *output, frame_profiler_t *profiler)
     {
-        this->output = output;
+        this->output   = output;
+        this->profiler = profiler;
     }
 
     void workaround_wlroots_backend_y_invert(wf::framebuffer_t& fb) const
@@ -315,30 +341,70 @@ struct postprocessing_manager_t
         OpenGL::render_end();
     }
 
-    void add_post(post_hook_t *hook)
+    /* Hooks which only need the damaged part of the output to be processed */
+    std::unordered_set<post_hook_t*> pixel_local_hooks;
+
+    void add_post(post_hook_t *hook, bool pixel_local)
     {
         post_effects.push_back(hook);
+        if (pixel_local)
+        {
+            pixel_local_hooks.insert(hook);
+        }
+
         output->render->damage_whole_idle();
     }
 
     void rem_post(post_hook_t *hook)
     {
         post_effects.remove_all(hook);
+        pixel_local_hooks.erase(hook);
+        profiler->forget_hook(hook);
         output->render->damage_whole_idle();
     }
 
+    /**
+     * @return Whether the whole chain can be run only on the damaged region.
+     */
+    bool is_pixel_local()
+    {
+        bool local = true;
+        post_effects.for_each([&] (auto post)
+        {
+            local &= (pixel_local_hooks.count(post) > 0);
+        });
+
+        return local;
+    }
+
     /* Run all postprocessing effects, rendering to alternating buffers and
      * finally to the screen.
      *
      * NB: 2 buffers just aren't enough. We render to the zero buffer, and then
      * we alternately render to the second and the third. The reason: We track
-     * damage. So, we need to keep the whole buffer each frame. */
-    void run_post_effects()
+     * damage. So, we need to keep the whole buffer each frame.
+     *
+     * If all hooks are pixel-local, only the damaged part of the zero buffer
+     * has changed, and only the damaged part of the output needs repainting.
+     * So, all hooks draw with a scissor box around the damage (in output-local
+     * coordinates). The intermediate buffers are valid only inside this box,
+     * which is enough because pixel-local hooks do not read outside of it. */
+    void run_post_effects(const wf::region_t& damage)
     {
         wf::framebuffer_base_t default_framebuffer;
         default_framebuffer.fb  = output_fb;
         default_framebuffer.tex = 0;
 
+        const bool local = is_pixel_local();
+        if (local && damage.empty())
+        {
+            return;
+        }
+
+        const wlr_box scissor_box = get_target_framebuffer()
+            .framebuffer_box_from_geometry_box(
+                wlr_box_from_pixman_box(damage.get_extents()));
+
         int last_buffer_idx = default_out_buffer;
         int next_buffer_idx = 1;
 
@@ -355,11 +421,26 @@ struct postprocessing_manager_t
             next_buffer.allocate(output_width, output_height);
             OpenGL::render_end();
 
+            if (local)
+            {
+                /* render_end() from the hook disables the scissor again */
+                next_buffer.scissor(scissor_box);
+            }
+
+            frame_profiler_t::scope_t scope{profiler, profiler->is_enabled() ?
+                profiler->get_hook_name(post, post->target_type()) : nullptr};
             (*post)(post_buffers[last_buffer_idx], next_buffer);
 
             last_buffer_idx  = next_buffer_idx;
             next_buffer_idx ^= 0b11; // alternate 1 and 2
         });
+
+        if (local)
+        {
+            /* In case the last hook did not call render_end() */
+            OpenGL::render_begin();
+            OpenGL::render_end();
+        }
     }
 
     wf::framebuffer_t get_target_framebuffer() const
@@ -538,6 +619,21 @@ class depth_buffer_manager_t
  * delay is increased by one. If the next frame is delayed, then
  * `increase_window` is doubled, otherwise, it is halved
  * (but it must stay between `MIN_INCREASE_WINDOW` and `MAX_INCREASE_WINDOW`).
+ *
+ * Alternatively, with core/predictive_repaint_delay, the delay is computed from
+ * the measured render times: it is the refresh interval minus the 99th
+ * percentile of the last render times, minus a safety margin. The render time
+ * of a frame ends when both the CPU and the GPU are done with it, so the GPU
+ * time is used when timer queries are available. The measurements are
+ * discarded when the renderer changes or a post hook is added, and the delay
+ * stays zero until enough new measurements are available. Other changes of the
+ * workload, like effect hooks of animations, are picked up as old measurements
+ * are replaced.
+ *
+ * A sudden increase of the render time would need a few late frames to raise
+ * the 99th percentile, so the most recent render times are taken into account
+ * too. After a missed frame, the delay stays zero until the late frame has
+ * been measured.
  */
 struct repaint_delay_manager_t
 {
@@ -598,6 +694,7 @@ struct repaint_delay_manager_t
         } else
         {
             // We missed last frame.
+            hold_prediction_until = render_times_end + PENDING_FRAMES;
             update_delay(-consecutive_decrease);
             // Next decrease should be faster
             consecutive_decrease = clamp(consecutive_decrease * 2, 1, 32);
@@ -620,12 +717,137 @@ struct repaint_delay_manager_t
      */
     int get_delay()
     {
-        return delay;
+        return predictive ? get_predicted_delay() : delay;
+    }
+
+    bool is_predictive()
+    {
+        return predictive;
+    }
+
+    /**
+     * Record how long the CPU took to render a frame.
+     *
+     * @param frame The number of the frame.
+     * @param cpu_usec The time from the start of the frame until the buffers
+     *   were swapped.
+     * @param gpu_start_usec The time from the start of the frame until the
+     *   first GL commands were issued.
+     * @param wait_for_gpu Whether the GPU time of the frame will be reported
+     *   with record_gpu_time(). Otherwise, or if it isn't reported within
+     *   PENDING_FRAMES frames, only the CPU time is used.
+     */
+    void record_cpu_time(uint32_t frame, int64_t cpu_usec,
+        int64_t gpu_start_usec, bool wait_for_gpu)
+    {
+        if (!wait_for_gpu)
+        {
+            add_render_time(cpu_usec);
+            return;
+        }
+
+        auto& pending = pending_frames[frame % PENDING_FRAMES];
+        if (pending.valid)
+        {
+            /* The GPU time of that frame didn't arrive within PENDING_FRAMES
+             * frames, for ex. because its query was skipped. Use its CPU time,
+             * so that the prediction doesn't run out of samples. */
+            add_render_time(pending.cpu_usec);
+        }
+
+        pending = {frame, cpu_usec, gpu_start_usec, true};
+    }
+
+    /** Record how long the GPU took to render a frame. */
+    void record_gpu_time(uint32_t frame, int64_t gpu_usec)
+    {
+        auto& pending = pending_frames[frame % PENDING_FRAMES];
+        if (!pending.valid || (pending.frame != frame))
+        {
+            return;
+        }
+
+        /* The GPU can start only after the commands have been issued */
+        add_render_time(std::max(pending.cpu_usec,
+            pending.gpu_start_usec + gpu_usec));
+        pending.valid = false;
+    }
+
+    /**
+     * Forget the measured render times, because they no longer predict how
+     * long the next frames will take.
+     */
+    void reset_render_times()
+    {
+        render_times_end = 0;
+        hold_prediction_until = 0;
+        for (auto& pending : pending_frames)
+        {
+            pending.valid = false;
+        }
     }
 
   private:
     int delay = 0;
 
+    static constexpr size_t RENDER_TIME_SAMPLES = 128;
+    /* Don't predict anything before a few frames have been measured */
+    static constexpr size_t MIN_RENDER_TIME_SAMPLES = 16;
+    static constexpr int64_t PREDICTION_MARGIN_USEC = 1000;
+
+    std::array<int64_t, RENDER_TIME_SAMPLES> render_times;
+    size_t render_times_end = 0;
+
+    void add_render_time(int64_t usec)
+    {
+        render_times[render_times_end % RENDER_TIME_SAMPLES] = usec;
+        ++render_times_end;
+    }
+
+    /* Frames waiting for their GPU time, which arrives a few frames later */
+    struct pending_frame_t
+    {
+        uint32_t frame;
+        int64_t cpu_usec;
+        int64_t gpu_start_usec;
+        bool valid = false;
+    };
+
+    static constexpr size_t PENDING_FRAMES = 8;
+    std::array<pending_frame_t, PENDING_FRAMES> pending_frames;
+
+    /* After a missed frame, don't predict anything until render_times_end
+     * reaches this, so that the late frame is measured first */
+    size_t hold_prediction_until = 0;
+
+    int get_predicted_delay()
+    {
+        if ((render_times_end < MIN_RENDER_TIME_SAMPLES) ||
+            (render_times_end < hold_prediction_until))
+        {
+            return 0;
+        }
+
+        auto samples = render_times;
+        size_t count = std::min(render_times_end, RENDER_TIME_SAMPLES);
+        auto p99     = samples.begin() + (count * 99) / 100;
+        std::nth_element(samples.begin(), p99, samples.begin() + count);
+
+        /* React to a slower workload before it shows in the percentile */
+        int64_t predicted = *p99;
+        for (size_t i = 1; i <= PENDING_FRAMES; i++)
+        {
+            predicted = std::max(predicted,
+                render_times[(render_times_end - i) % RENDER_TIME_SAMPLES]);
+        }
+
+        const int64_t refresh_usec = this->refresh_nsec / 1000;
+        const int64_t delay_usec   =
+            refresh_usec - predicted - PREDICTION_MARGIN_USEC;
+        return clamp(int(delay_usec / 1000), 0, std::max(0,
+            int(refresh_usec / 1000) - 1));
+    }
+
     void update_delay(int delta)
     {
         int config_delay = std::max(0,
@@ -664,9 +886,10 @@ struct repaint_delay_manager_t
     // Time of last frame
     int64_t last_pageflip = -1; // -1 is invalid
 
-    int64_t refresh_nsec;
+    int64_t refresh_nsec = 0;
     wf::option_wrapper_t<int> max_render_time{"core/max_render_time"};
     wf::option_wrapper_t<bool> dynamic_delay{"workarounds/dynamic_repaint_delay"};
+    wf::option_wrapper_t<bool> predictive{"core/predictive_repaint_delay"};
 
     wf::wl_listener_wrapper on_present;
 };
@@ -684,17 +907,23 @@ class wf::render_manager::impl
     std::unique_ptr<postprocessing_manager_t> postprocessing;
     std::unique_ptr<depth_buffer_manager_t> depth_buffer_manager;
     std::unique_ptr<repaint_delay_manager_t> delay_manager;
+    frame_profiler_t *profiler;
 
     wf::option_wrapper_t<wf::color_t> background_color_opt;
 
     impl(output_t *o) :
         output(o)
     {
+        profiler = &static_cast<output_impl_t*>(o)->get_frame_profiler();
         output_damage = std::make_unique<output_damage_t>(o);
-        effects = std::make_unique<effect_hook_manager_t>();
-        postprocessing = std::make_unique<postprocessing_manager_t>(o);
+        effects = std::make_unique<effect_hook_manager_t>(profiler);
+        postprocessing = std::make_unique<postprocessing_manager_t>(o, profiler);
         depth_buffer_manager = std::make_unique<depth_buffer_manager_t>();
         delay_manager = std::make_unique<repaint_delay_manager_t>(o);
+        profiler->set_gpu_time_callback([=] (uint32_t frame, int64_t usec)
+        {
+            delay_manager->record_gpu_time(frame, usec);
+        });
 
         on_frame.set_callback([&] (void*)
         {
@@ -720,6 +949,18 @@ class wf::render_manager::impl
             send_frame_done();
         });
         on_frame.connect(&output_damage->damage_manager->events.frame);
+        wf::get_core().connect_signal("surface-mapped", &on_surface_map_changed);
+        wf::get_core().connect_signal("surface-unmapped",
+            &on_surface_map_changed);
+        for (auto signal : {"view-geometry-changed", "view-mapped",
+            "view-disappeared", "view-minimized", "view-attached",
+            "view-detached", "view-layer-attached", "view-layer-detached",
+            "view-change-workspace", "view-transformer-changed",
+            "stack-order-changed", "workspace-changed",
+            "output-configuration-changed"})
+        {
+            output->connect_signal(signal, &on_occlusion_changed);
+        }
 
         default_stream.scale_x    = default_stream.scale_y = 1;
         default_stream.buffer.tex = 0;
@@ -740,6 +981,9 @@ class wf::render_manager::impl
     void set_renderer(render_hook_t rh)
     {
         renderer = rh;
+        /* Custom renderers may show hidden surfaces */
+        hidden_surfaces.clear();
+        delay_manager->reset_render_times();
         output_damage->damage_whole_idle();
     }
 
@@ -940,9 +1184,16 @@ class wf::render_manager::impl
      */
     void paint()
     {
+        profiler->begin_frame();
+        frame_profiler_t::scope_t frame_scope{profiler, "frame"};
+        const auto frame_start = std::chrono::steady_clock::now();
+
         /* Part 1: frame setup: query damage, etc. */
-        effects->run_effects(OUTPUT_EFFECT_PRE);
-        effects->run_effects(OUTPUT_EFFECT_DAMAGE);
+        {
+            frame_profiler_t::scope_t scope{profiler, "effects-pre"};
+            effects->run_effects(OUTPUT_EFFECT_PRE);
+            effects->run_effects(OUTPUT_EFFECT_DAMAGE);
+        }
 
         if (do_direct_scanout())
         {
@@ -978,21 +1229,35 @@ class wf::render_manager::impl
         output_damage->accumulate_damage();
 
         update_bound_output();
+        const auto gpu_start = std::chrono::steady_clock::now();
+        profiler->begin_gpu(delay_manager->is_predictive());
 
         /* Part 2: call the renderer, which sets swap_damage and
          * draws the scenegraph */
-        render_output();
+        {
+            frame_profiler_t::scope_t scope{profiler, "render"};
+            render_output();
+        }
 
         /* Part 3: overlay effects */
-        effects->run_effects(OUTPUT_EFFECT_OVERLAY);
+        {
+            frame_profiler_t::scope_t scope{profiler, "effects-overlay"};
+            effects->run_effects(OUTPUT_EFFECT_OVERLAY);
+        }
 
-        if (postprocessing->post_effects.size())
+        if (postprocessing->post_effects.size() &&
+            !postprocessing->is_pixel_local())
         {
             swap_damage |= output_damage->get_wlr_damage_box();
         }
 
         /* Part 4: finalize the scene: postprocessing effects */
-        postprocessing->run_post_effects();
+        {
+            frame_profiler_t::scope_t scope{profiler, "post-effects"};
+            postprocessing->run_post_effects(
+                swap_damage * (1.0 / output->handle->scale));
+        }
+
         if (output_inhibit_counter)
         {
             OpenGL::render_begin(output->handle->width, output->handle->height,
@@ -1004,17 +1269,31 @@ class wf::render_manager::impl
         /* Part 5: render sw cursors
          * We render software cursors after everything else
          * for consistency with hardware cursor planes */
-        OpenGL::render_begin();
-        wlr_renderer_begin(wf::get_core().renderer,
-            output->handle->width, output->handle->height);
-        wlr_output_render_software_cursors(output->handle,
-            swap_damage.to_pixman());
-        wlr_renderer_end(wf::get_core().renderer);
-        OpenGL::render_end();
+        {
+            frame_profiler_t::scope_t scope{profiler, "software-cursors"};
+            OpenGL::render_begin();
+            wlr_renderer_begin(wf::get_core().renderer,
+                output->handle->width, output->handle->height);
+            wlr_output_render_software_cursors(output->handle,
+                swap_damage.to_pixman());
+            wlr_renderer_end(wf::get_core().renderer);
+            OpenGL::render_end();
+        }
 
         /* Part 6: finalize frame: swap buffers, send frame_done, etc */
+        profiler->end_gpu();
         OpenGL::unbind_output(output);
-        output_damage->swap_buffers(swap_damage);
+        {
+            frame_profiler_t::scope_t scope{profiler, "swap"};
+            output_damage->swap_buffers(swap_damage);
+        }
+
+        using namespace std::chrono;
+        delay_manager->record_cpu_time(profiler->get_frame(),
+            duration_cast<microseconds>(steady_clock::now() - frame_start).count(),
+            duration_cast<microseconds>(gpu_start - frame_start).count(),
+            delay_manager->is_predictive() && profiler->has_gpu_times());
+
         swap_damage.clear();
         post_paint();
     }
@@ -1024,7 +1303,10 @@ class wf::render_manager::impl
      */
     void post_paint()
     {
-        effects->run_effects(OUTPUT_EFFECT_POST);
+        {
+            frame_profiler_t::scope_t scope{profiler, "effects-post"};
+            effects->run_effects(OUTPUT_EFFECT_POST);
+        }
 
         if (constant_redraw_counter)
         {
@@ -1032,17 +1314,153 @@ class wf::render_manager::impl
         }
     }
 
+    wf::option_wrapper_t<int> occluded_frame_rate{"core/occluded_frame_rate"};
+    /* When frame callbacks were last sent to occluded surfaces */
+    uint32_t last_occluded_frame_done = 0;
+    wf::wl_timer occluded_frame_timer;
+
+    /* Surfaces found hidden at the last frame: fully occluded, minimized or
+     * on another workspace. Empty while surfaces may be shown regardless, i.e
+     * with a custom renderer or while other workspace streams run. */
+    std::unordered_set<wf::surface_interface_t*> hidden_surfaces;
+    /* Running workspace streams, not counting the default stream */
+    int running_streams = 0;
+
+    /* A new surface may reuse the address of a hidden one */
+    wf::signal_connection_t on_surface_map_changed = [=] (wf::signal_data_t *data)
+    {
+        auto ev = static_cast<surface_map_state_changed_signal*>(data);
+        hidden_surfaces.erase(ev->surface);
+        occlusion_dirty = true;
+    };
+
+    /* The surfaces on the current workspace which are not fully occluded, as
+     * found by find_unoccluded_surfaces(). They are found again only when the
+     * views or surfaces change in a way which may change the occlusion. */
+    std::unordered_set<wf::surface_interface_t*> unoccluded_surfaces;
+    bool occlusion_dirty = true;
+
+    wf::signal_connection_t on_occlusion_changed = [=] (wf::signal_data_t*)
+    {
+        occlusion_dirty = true;
+    };
+
+    void invalidate_occlusion()
+    {
+        occlusion_dirty = true;
+    }
+
+    bool is_surface_hidden(wf::surface_interface_t *surface)
+    {
+        return hidden_surfaces.count(surface);
+    }
+
+    void schedule_hidden_frame_done()
+    {
+        if (occluded_frame_rate > 0)
+        {
+            schedule_occluded_frame_done(1000 / occluded_frame_rate);
+        }
+    }
+
+    /**
+     * Find the surfaces on the current workspace which are not fully covered
+     * by opaque surfaces above them. This is the same pass which finds the
+     * surfaces to repaint, but with the whole workspace as damage.
+     *
+     * The bounding box of views with transformers changes on each frame of
+     * an animation without any signal, so if such views are visible, the
+     * result is marked as outdated right away.
+     */
+    std::unordered_set<wf::surface_interface_t*> find_unoccluded_surfaces()
+    {
+        auto cws = output->workspace->get_current_workspace();
+
+        workspace_stream_repaint_t visibility;
+        visibility.ws_damage = output_damage->get_ws_box(cws);
+        visibility.ws_dx     = visibility.ws_dy = 0;
+        check_schedule_surfaces(visibility, cws);
+
+        std::unordered_set<wf::surface_interface_t*> unoccluded;
+        occlusion_dirty = false;
+        for (auto& ds : visibility.to_render)
+        {
+            if (ds->view)
+            {
+                occlusion_dirty = true;
+                for (auto& child : ds->view->enumerate_surfaces())
+                {
+                    unoccluded.insert(child.surface);
+                }
+            } else
+            {
+                unoccluded.insert(ds->surface);
+            }
+        }
+
+        return unoccluded;
+    }
+
+    /**
+     * Make sure that occluded surfaces which did not get a frame callback get
+     * one when the throttling interval is over, even if nothing else causes
+     * the output to be repainted.
+     */
+    void schedule_occluded_frame_done(uint32_t interval)
+    {
+        if (occluded_frame_timer.is_connected())
+        {
+            return;
+        }
+
+        int32_t elapsed = get_current_time() - last_occluded_frame_done;
+        occluded_frame_timer.set_timeout(std::max(1, (int)interval - elapsed),
+            [=] ()
+        {
+            output_damage->schedule_repaint();
+            return false;
+        });
+    }
+
     /**
      * Send frame_done to clients.
+     *
+     * Surfaces which are fully occluded, minimized or on another workspace
+     * get frame callbacks at most core/occluded_frame_rate times per second,
+     * so that hidden clients do not keep rendering at full speed. The hidden
+     * surfaces are remembered, so that their commits do not cause repaints.
      */
     void send_frame_done()
     {
-        /* TODO: do this only if the view isn't fully occluded by another */
         std::vector<wayfire_view> visible_views;
+
+        /* Custom renderers may show any workspace, so occlusion is known only
+         * when rendering the current workspace. */
+        bool cull = !renderer && (occluded_frame_rate >= 0);
+        bool track_hidden = cull && (running_streams == 0);
+
+        /* A rate of 0 means that occluded surfaces get no frame callbacks */
+        uint32_t interval = (occluded_frame_rate > 0) ?
+            1000 / occluded_frame_rate : 0;
+        bool send_occluded = !cull || ((occluded_frame_rate > 0) &&
+            (get_current_time() - last_occluded_frame_done >= interval));
+        bool skipped_occluded = false;
+
+        hidden_surfaces.clear();
         if (renderer)
         {
             visible_views = output->workspace->get_views_in_layer(
                 wf::VISIBLE_LAYERS);
+        } else if (cull)
+        {
+            visible_views = output->workspace->get_views_in_layer(
+                wf::ALL_LAYERS);
+            /* Changes which are not signalled, like subsurfaces moving, are
+             * picked up at least when occluded surfaces get frame callbacks */
+            if (occlusion_dirty || send_occluded)
+            {
+                unoccluded_surfaces = find_unoccluded_surfaces();
+            }
         } else
         {
             visible_views = output->workspace->get_views_on_workspace(
@@ -1057,6 +1475,12 @@ class wf::render_manager::impl
                 additional_views.begin(), additional_views.end());
         }
 
+        if (!cull)
+        {
+            /* Not tracked while culling is off */
+            occlusion_dirty = true;
+        }
+
         timespec repaint_ended;
         clockid_t presentation_clock =
             wlr_backend_get_presentation_clock(wf::get_core_impl().backend);
@@ -1070,24 +1494,56 @@ class wf::render_manager::impl
                     continue;
                 }
 
+                /* Transformed views are rendered from a snapshot, which needs
+                 * the damage of all commits to stay up to date */
+                bool may_hide = track_hidden && !view->has_transformer();
                 for (auto& child : view->enumerate_surfaces())
                 {
-                    child.surface->send_frame_done(repaint_ended);
+                    bool visible = !cull ||
+                        unoccluded_surfaces.count(child.surface);
+                    if (!visible && may_hide)
+                    {
+                        hidden_surfaces.insert(child.surface);
+                    }
+
+                    if (send_occluded || visible)
+                    {
+                        child.surface->send_frame_done(repaint_ended);
+                    } else
+                    {
+                        skipped_occluded = true;
+                    }
                 }
             }
         }
+
+        if (cull && send_occluded)
+        {
+            last_occluded_frame_done = get_current_time();
+        }
+
+        if (skipped_occluded && (occluded_frame_rate > 0))
+        {
+            schedule_occluded_frame_done(interval);
+        }
     }
 
     /* Workspace stream implementation */
     void workspace_stream_start(workspace_stream_t& stream)
     {
+        if (!stream.running && (&stream != &default_stream))
+        {
+            /* The stream may show hidden surfaces */
+            ++running_streams;
+            hidden_surfaces.clear();
+        }
+
         stream.running = true;
-        stream.scale_x = stream.scale_y = 1;
 
         /* damage the whole workspace region, so that we get a full repaint
          * when updating the workspace */
         output_damage->damage(output_damage->get_ws_box(stream.ws));
-        workspace_stream_update(stream, 1, 1);
+        workspace_stream_update(stream, stream.scale_x, stream.scale_y);
     }
 
     /**
@@ -1239,12 +1695,11 @@ class wf::render_manager::impl
      * they need repaint.
      */
     void check_schedule_surfaces(workspace_stream_repaint_t& repaint,
-        workspace_stream_t& stream)
+        wf::point_t ws)
     {
-        auto views = output->workspace->get_views_on_workspace(stream.ws,
+        auto views = output->workspace->get_views_on_workspace(ws,
             wf::VISIBLE_LAYERS);
 
-        schedule_drag_icon(repaint);
         for (auto& v : views)
         {
             for (auto& view : v->enumerate_views(false))
@@ -1286,6 +1741,36 @@ class wf::render_manager::impl
         }
     }
 
+    /**
+     * Get the scale at which a stream is rendered. Streams are scaled
+     * uniformly, so the larger of the requested scales is used.
+     */
+    static float get_stream_render_scale(const workspace_stream_t& stream)
+    {
+        return std::clamp(std::max(stream.scale_x, stream.scale_y), 0.05f, 1.0f);
+    }
+
+    /**
+     * Expand the damage of a scaled stream so that it covers whole pixels of
+     * the stream. Otherwise, the pixels on the edge of the damage would be
+     * cleared, but surfaces which touch them would not be repainted.
+     *
+     * @param origin The position of the stream's workspace, output-local.
+     * @param scale The scale from output-local coordinates to stream pixels.
+     */
+    static wf::region_t align_damage_to_pixels(const wf::region_t& damage,
+        wf::point_t origin, double scale)
+    {
+        wf::region_t aligned;
+        for (const auto& rect : damage)
+        {
+            auto box = wlr_box_from_pixman_box(rect) + -origin;
+            aligned |= ((box * scale) * (1.0 / scale)) + origin;
+        }
+
+        return aligned;
+    }
+
     /**
      * Setup the stream, calculate damaged region, etc.
      */
@@ -1295,23 +1780,30 @@ class wf::render_manager::impl
         workspace_stream_repaint_t repaint;
         repaint.ws_damage = output_damage->get_ws_damage(stream.ws);
 
-        /* we don't have to update anything */
-        if (repaint.ws_damage.empty())
+        /* The default stream renders directly to the output */
+        if (stream.buffer.tex == 0)
         {
-            return repaint;
+            scale_x = scale_y = 1;
         }
 
         if ((scale_x != stream.scale_x) || (scale_y != stream.scale_y))
         {
-            /* FIXME: enable scaled rendering */
-            // stream->scale_x = scale_x;
-            // stream->scale_y = scale_y;
+            /* The whole stream has to be rendered again at the new size */
+            stream.scale_x = scale_x;
+            stream.scale_y = scale_y;
+            repaint.ws_damage |= output_damage->get_ws_box(stream.ws);
+        }
 
-            // ws_damage |= get_damage_box();
+        /* we don't have to update anything */
+        if (repaint.ws_damage.empty())
+        {
+            return repaint;
         }
 
+        const float scale = get_stream_render_scale(stream);
         OpenGL::render_begin();
-        stream.buffer.allocate(output->handle->width, output->handle->height);
+        stream.buffer.allocate(std::ceil(output->handle->width * scale),
+            std::ceil(output->handle->height * scale));
         OpenGL::render_end();
 
         repaint.fb = postprocessing->get_target_framebuffer();
@@ -1320,6 +1812,9 @@ class wf::render_manager::impl
             /* Use the workspace buffers */
             repaint.fb.fb  = stream.buffer.fb;
             repaint.fb.tex = stream.buffer.tex;
+            repaint.fb.viewport_width  = stream.buffer.viewport_width;
+            repaint.fb.viewport_height = stream.buffer.viewport_height;
+            repaint.fb.scale *= scale;
         }
 
         auto g   = output->get_relative_geometry();
@@ -1330,6 +1825,13 @@ class wf::render_manager::impl
         repaint.fb.geometry.x = repaint.ws_dx;
         repaint.fb.geometry.y = repaint.ws_dy;
 
+        if (scale != 1)
+        {
+            repaint.ws_damage = align_damage_to_pixels(repaint.ws_damage,
+                {repaint.ws_dx, repaint.ws_dy}, repaint.fb.scale);
+            repaint.ws_damage &= output_damage->get_ws_box(stream.ws);
+        }
+
         return repaint;
     }
 
@@ -1395,10 +1897,13 @@ class wf::render_manager::impl
 
         {
             stream_signal_t data(stream.ws, repaint.ws_damage, repaint.fb);
-            output->render->emit_signal("workspace-stream-pre", &data);
+            static const wf::signal_id_t stream_pre =
+                wf::get_signal_id("workspace-stream-pre");
+            output->render->emit_signal(stream_pre, &data);
         }
 
-        check_schedule_surfaces(repaint, stream);
+        schedule_drag_icon(repaint);
+        check_schedule_surfaces(repaint, stream.ws);
 
         if (stream.background.a < 0)
         {
@@ -1413,12 +1918,19 @@ class wf::render_manager::impl
         unschedule_drag_icon();
         {
             stream_signal_t data(stream.ws, repaint.ws_damage, repaint.fb);
-            output->render->emit_signal("workspace-stream-post", &data);
+            static const wf::signal_id_t stream_post =
+                wf::get_signal_id("workspace-stream-post");
+            output->render->emit_signal(stream_post, &data);
         }
     }
 
     void workspace_stream_stop(workspace_stream_t& stream)
     {
+        if (stream.running && (&stream != &default_stream))
+        {
+            --running_streams;
+        }
+
         stream.running = false;
     }
 };
@@ -1447,6 +1959,21 @@ void render_manager::schedule_redraw()
     pimpl->output_damage->schedule_repaint();
 }
 
+bool render_manager::is_surface_hidden(wf::surface_interface_t *surface)
+{
+    return pimpl->is_surface_hidden(surface);
+}
+
+void render_manager::schedule_hidden_frame_done()
+{
+    pimpl->schedule_hidden_frame_done();
+}
+
+void render_manager::invalidate_occlusion()
+{
+    pimpl->invalidate_occlusion();
+}
+
 void render_manager::add_inhibit(bool add)
 {
     pimpl->add_inhibit(add);
@@ -1462,9 +1989,12 @@ void render_manager::rem_effect(effect_hook_t *hook)
     pimpl->effects->rem_effect(hook);
 }
 
-void render_manager::add_post(post_hook_t *hook)
+void render_manager::add_post(post_hook_t *hook, bool pixel_local)
 {
-    pimpl->postprocessing->add_post(hook);
+    pimpl->postprocessing->add_post(hook, pixel_local);
+    /* Post hooks like blur change the render time of each frame for as long
+     * as they are active */
+    pimpl->delay_manager->reset_render_times();
 }
 
 void render_manager::rem_post(post_hook_t *hook)
@@ -1515,7 +2045,7 @@ void render_manager::workspace_stream_start(workspace_stream_t& stream)
 void render_manager::workspace_stream_update(workspace_stream_t& stream,
     float scale_x, float scale_y)
 {
-    pimpl->workspace_stream_update(stream);
+    pimpl->workspace_stream_update(stream, scale_x, scale_y);
 }
 
 void render_manager::workspace_stream_stop(workspace_stream_t& stream)
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdlib>
+#include <set>
 
 #include "xdg-shell.hpp"
 #include "wayfire/core.hpp"
@@ -10,6 +11,8 @@
 #include "wayfire/output.hpp"
 #include "wayfire/workspace-manager.hpp"
 #include "wayfire/output-layout.hpp"
+#include "wayfire/signal-definitions.hpp"
+#include "wayfire/util.hpp"
 #include "view-impl.hpp"
 
 static const uint32_t both_vert =
@@ -17,6 +20,8 @@ static const uint32_t both_vert =
 static const uint32_t both_horiz =
     ZWLR_LAYER_SURFACE_V1_ANCHOR_LEFT | ZWLR_LAYER_SURFACE_V1_ANCHOR_RIGHT;
 
+static wf::layer_shell_stats_t layer_shell_stats;
+
 class wayfire_layer_shell_view : public wf::wlr_view_t
 {
     wf::wl_listener_wrapper on_map, on_unmap, on_destroy, on_new_popup;
@@ -90,10 +95,21 @@ struct wf_layer_shell_manager
         }
     };
 
+    /* Outputs whose layers are arranged on the next idle */
+    std::set<wf::output_t*> pending_arrange;
+    wf::wl_idle_call idle_arrange;
+
+    wf::signal_connection_t on_output_removed = [=] (wf::signal_data_t *data)
+    {
+        pending_arrange.erase(wf::get_signaled_output(data));
+    };
+
     wf_layer_shell_manager()
     {
         wf::get_core().output_layout->connect_signal("configuration-changed",
             &on_output_layout_changed);
+        wf::get_core().output_layout->connect_signal("output-removed",
+            &on_output_removed);
     }
 
   public:
@@ -318,9 +334,38 @@ struct wf_layer_shell_manager
         return focus_mask;
     }
 
+    /**
+     * Arrange the layers of the output once the event loop is idle. All
+     * requests for the same output until then result in a single pass, so that
+     * a client committing several surfaces in a row reflows the workarea once.
+     */
+    void schedule_arrange(wf::output_t *output)
+    {
+        ++layer_shell_stats.requests;
+        if (!pending_arrange.insert(output).second)
+        {
+            ++layer_shell_stats.coalesced;
+            return;
+        }
+
+        idle_arrange.run_once([=] ()
+        {
+            auto outputs = std::move(pending_arrange);
+            pending_arrange.clear();
+            for (auto wo : outputs)
+            {
+                arrange_layers(wo);
+            }
+        });
+    }
+
     uint32_t focused_layer_request_uid = -1;
     void arrange_layers(wf::output_t *output)
     {
+        /* Arranging now also satisfies a scheduled arrangement */
+        pending_arrange.erase(output);
+        ++layer_shell_stats.passes;
+
         auto views = filter_views(output);
 
         arrange_layer(output, ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY);
@@ -467,6 +512,24 @@ void wayfire_layer_shell_view::unmap()
     wf_layer_shell_manager::get_instance().handle_unmap(this);
 }
 
+/**
+ * Check whether the difference between two states of a layer surface can change
+ * the arrangement of the layers or the keyboard focus layer.
+ */
+static bool affects_arrangement(const wlr_layer_surface_v1_state& a,
+    const wlr_layer_surface_v1_state& b)
+{
+    return a.anchor != b.anchor ||
+           a.exclusive_zone != b.exclusive_zone ||
+           a.margin.top != b.margin.top ||
+           a.margin.bottom != b.margin.bottom ||
+           a.margin.left != b.margin.left ||
+           a.margin.right != b.margin.right ||
+           a.desired_width != b.desired_width ||
+           a.desired_height != b.desired_height ||
+           a.keyboard_interactive != b.keyboard_interactive;
+}
+
 void wayfire_layer_shell_view::commit()
 {
     wf::wlr_view_t::commit();
@@ -484,10 +547,16 @@ void wayfire_layer_shell_view::commit()
             get_output()->workspace->add_view(self(), get_layer());
             /* Will also trigger reflowing */
             wf_layer_shell_manager::get_instance().handle_move_layer(this);
+        } else if (!affects_arrangement(prev_state, *state))
+        {
+            /* Nothing the positions and reserved areas depend on changed, for
+             * ex. a commit which only sets the input region */
+            ++layer_shell_stats.requests;
+            ++layer_shell_stats.unchanged;
         } else
         {
             /* Reflow reserved areas and positions */
-            wf_layer_shell_manager::get_instance().arrange_layers(get_output());
+            wf_layer_shell_manager::get_instance().schedule_arrange(get_output());
         }
 
         prev_state = *state;
@@ -567,6 +636,11 @@ void wayfire_layer_shell_view::remove_anchored(bool reflow)
     }
 }
 
+wf::layer_shell_stats_t wf::get_layer_shell_stats()
+{
+    return layer_shell_stats;
+}
+
 static wlr_layer_shell_v1 *layer_shell_handle;
 void wf::init_layer_shell()
 {
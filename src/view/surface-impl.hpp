@@ -81,6 +81,10 @@ class wlr_surface_base_t
     virtual void commit();
 
     virtual wlr_buffer *get_buffer();
+
+  private:
+    /* The size at the last commit, to notice when the occlusion may change */
+    wf::dimensions_t committed_size = {0, 0};
 };
 
 /**
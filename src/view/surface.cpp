@@ -311,12 +311,13 @@ wf::dimensions_t wf::wlr_surface_base_t::_get_size() const
 
 void wf::emit_map_state_change(wf::surface_interface_t *surface)
 {
-    std::string state =
-        surface->is_mapped() ? "surface-mapped" : "surface-unmapped";
+    static const wf::signal_id_t mapped = wf::get_signal_id("surface-mapped");
+    static const wf::signal_id_t unmapped =
+        wf::get_signal_id("surface-unmapped");
 
     surface_map_state_changed_signal data;
     data.surface = surface;
-    wf::get_core().emit_signal(state, &data);
+    wf::get_core().emit_signal(surface->is_mapped() ? mapped : unmapped, &data);
 }
 
 void wf::wlr_surface_base_t::map(wlr_surface *surface)
@@ -399,12 +400,31 @@ void wf::wlr_surface_base_t::apply_surface_damage()
 
 void wf::wlr_surface_base_t::commit()
 {
+    auto output = _as_si->get_output();
+
+    /* A resized surface may stick out of the surfaces which covered it */
+    bool resized   = (_get_size() != committed_size);
+    committed_size = _get_size();
+    if (output && !resized && output->render->is_surface_hidden(_as_si))
+    {
+        /* Nothing visible changed, so we neither damage nor repaint the
+         * output. The client still gets throttled frame callbacks. */
+        output->render->schedule_hidden_frame_done();
+        return;
+    }
+
     apply_surface_damage();
-    if (_as_si->get_output())
+    if (output)
     {
+        if (resized ||
+            (surface->current.committed & WLR_SURFACE_STATE_OPAQUE_REGION))
+        {
+            output->render->invalidate_occlusion();
+        }
+
         /* we schedule redraw, because the surface might expect
          * a frame callback */
-        _as_si->get_output()->render->schedule_redraw();
+        output->render->schedule_redraw();
     }
 }
 
@@ -436,23 +456,16 @@ void wf::wlr_surface_base_t::_simple_render(const wf::framebuffer_t& fb,
     wf::texture_t texture{surface};
 
     OpenGL::render_begin(fb);
-    OpenGL::render_texture(texture, fb, geometry, glm::vec4(1.f),
-        OpenGL::RENDER_FLAG_CACHED);
     // use GL_NEAREST for integer scale.
     // GL_NEAREST makes scaled text blocky instead of blurry, which looks better
     // but only for integer scale.
     if (fb.scale - floor(fb.scale) < 0.001)
     {
+        GL_CALL(glBindTexture(texture.target, texture.tex_id));
         GL_CALL(glTexParameteri(texture.target, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
     }
 
-    for (const auto& rect : damage)
-    {
-        fb.logic_scissor(wlr_box_from_pixman_box(rect));
-        OpenGL::draw_cached();
-    }
-
-    OpenGL::clear_cached();
+    OpenGL::render_damaged_texture(texture, fb, geometry, damage);
     OpenGL::render_end();
 }
 
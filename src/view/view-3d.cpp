@@ -33,6 +33,35 @@ wf::region_t wf::view_transformer_t::transform_opaque_region(
     return {};
 }
 
+wf::region_t wf::view_transformer_t::transform_damage_region(
+    wf::geometry_t view, const wf::region_t& damage)
+{
+    return get_bounding_box(view, view);
+}
+
+/**
+ * Transform the damage by transforming the bounding box of each of its
+ * rectangles. Suitable for transformers which map rectangles to convex
+ * quadrilaterals, for ex. affine and perspective transforms.
+ */
+static wf::region_t transform_damage_boxes(wf::view_transformer_t *transformer,
+    wf::geometry_t view, const wf::region_t& damage)
+{
+    wf::region_t result;
+    for (const auto& rect : damage)
+    {
+        /* Grow the boxes by a pixel before and after transforming, so that
+         * we account for rounding and for linear texture filtering, which
+         * samples the neighbouring pixels. */
+        auto box = wlr_box_from_pixman_box(rect);
+        box = transformer->get_bounding_box(view,
+            {box.x - 1, box.y - 1, box.width + 2, box.height + 2});
+        result |= wlr_box{box.x - 1, box.y - 1, box.width + 2, box.height + 2};
+    }
+
+    return result;
+}
+
 void wf::view_transformer_t::render_with_damage(wf::texture_t src_tex,
     wlr_box src_box,
     const wf::region_t& damage, const wf::framebuffer_t& target_fb)
@@ -147,6 +176,12 @@ wf::pointf_t wf::view_2D::untransform_point(
     return get_absolute_coords_from_relative(wm_geom, {x, y});
 }
 
+wf::region_t wf::view_2D::transform_damage_region(
+    wf::geometry_t view, const wf::region_t& damage)
+{
+    return transform_damage_boxes(this, view, damage);
+}
+
 void wf::view_2D::render_box(wf::texture_t src_tex, wlr_box src_box,
     wlr_box scissor_box, const wf::framebuffer_t& fb)
 {
@@ -175,6 +210,36 @@ void wf::view_2D::render_box(wf::texture_t src_tex, wlr_box src_box,
     OpenGL::render_end();
 }
 
+bool wf::view_2D::render_surfaces_with_2D_transform(
+    const std::vector<surface_texture_t>& surfaces,
+    const wf::region_t& damage, const wf::framebuffer_t& target_fb)
+{
+    if (alpha < 1.0f)
+    {
+        for (size_t i = 0; i < surfaces.size(); i++)
+        {
+            for (size_t j = i + 1; j < surfaces.size(); j++)
+            {
+                if (surfaces[i].box & surfaces[j].box)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    for (const auto& rect : damage)
+    {
+        auto scissor_box = wlr_box_from_pixman_box(rect);
+        for (const auto& surface : surfaces)
+        {
+            render_box(surface.texture, surface.box, scissor_box, target_fb);
+        }
+    }
+
+    return true;
+}
+
 const float wf::view_3D::fov = PI / 4;
 glm::mat4 wf::view_3D::default_view_matrix()
 {
@@ -265,6 +330,12 @@ wf::pointf_t wf::view_3D::untransform_point(wf::geometry_t geometry,
     return get_absolute_coords_from_relative(wm_geom, {res.x, res.y});
 }
 
+wf::region_t wf::view_3D::transform_damage_region(
+    wf::geometry_t view, const wf::region_t& damage)
+{
+    return transform_damage_boxes(this, view, damage);
+}
+
 void wf::view_3D::render_box(wf::texture_t src_tex, wlr_box src_box,
     wlr_box scissor_box, const wf::framebuffer_t& fb)
 {
@@ -67,6 +67,11 @@ class view_interface_t::view_priv_impl
     int visibility_counter   = 1;
 
     wf::safe_list_t<std::shared_ptr<view_transform_block_t>> transforms;
+    /**
+     * Damage accumulated on the view since the intermediate buffers of the
+     * transformers were last updated, in output-local coordinates.
+     */
+    wf::region_t transforms_damage;
 
     struct offscreen_buffer_t : public wf::framebuffer_t
     {
@@ -247,6 +252,21 @@ void init_xdg_shell();
 void init_xwayland();
 void init_layer_shell();
 
+/** Counters of the layer-shell arrangement passes, since startup. */
+struct layer_shell_stats_t
+{
+    /** Arrangements requested by commits of mapped layer surfaces. */
+    uint64_t requests = 0;
+    /** Requests dropped because no layout-relevant state changed. */
+    uint64_t unchanged = 0;
+    /** Requests merged into an already scheduled arrangement. */
+    uint64_t coalesced = 0;
+    /** Arrangements of an output actually done, each reflowing its workarea. */
+    uint64_t passes = 0;
+};
+
+layer_shell_stats_t get_layer_shell_stats();
+
 std::string xwayland_get_display();
 void xwayland_update_default_cursor();
 
@@ -9,6 +9,7 @@
 #include "wayfire/render-manager.hpp"
 #include "xdg-shell.hpp"
 #include "../output/gtk-shell.hpp"
+#include "../output/output-impl.hpp"
 
 #include <algorithm>
 #include <glm/glm.hpp>
@@ -761,6 +762,7 @@ void wf::view_interface_t::damage()
 {
     auto bbox = get_untransformed_bounding_box();
     view_impl->offscreen_buffer.cached_damage |= bbox;
+    view_impl->transforms_damage |= bbox;
     view_damage_raw(self(), transform_region(bbox));
 }
 
@@ -852,6 +854,18 @@ void wf::view_interface_t::set_decoration(
     emit_signal("decoration-changed", nullptr);
 }
 
+static void emit_transformer_changed(wf::view_interface_t *view)
+{
+    wf::view_transformer_changed_signal data;
+    data.view = view->self();
+
+    view->emit_signal("transformer-changed", &data);
+    if (view->get_output())
+    {
+        view->get_output()->emit_signal("view-transformer-changed", &data);
+    }
+}
+
 void wf::view_interface_t::add_transformer(
     std::unique_ptr<wf::view_transformer_t> transformer)
 {
@@ -878,6 +892,7 @@ void wf::view_interface_t::add_transformer(
     });
 
     damage();
+    emit_transformer_changed(this);
 }
 
 nonstd::observer_ptr<wf::view_transformer_t> wf::view_interface_t::get_transformer(
@@ -903,6 +918,9 @@ void wf::view_interface_t::pop_transformer(
         return tr->transform.get() == transformer.get();
     });
 
+    /* The input of the transformers after the removed one has changed */
+    view_impl->transforms_damage |= get_untransformed_bounding_box();
+
     /* Since we can remove transformers while rendering the output, damaging it
      * won't help at this stage (damage is already calculated).
      *
@@ -911,6 +929,8 @@ void wf::view_interface_t::pop_transformer(
     {
         get_output()->render->damage_whole_idle();
     }
+
+    emit_transformer_changed(this);
 }
 
 void wf::view_interface_t::pop_transformer(std::string name)
@@ -1054,6 +1074,38 @@ wf::region_t wf::view_interface_t::get_transformed_opaque_region()
     return opaque;
 }
 
+/**
+ * Get the textures of the view's surfaces, from the bottom to the top, or
+ * nothing if a surface has no texture, for ex. a decoration which draws itself.
+ */
+static std::vector<wf::surface_texture_t> get_surface_textures(
+    wf::view_interface_t *view)
+{
+    std::vector<wf::surface_texture_t> result;
+    auto og = view->get_output_geometry();
+    auto children = view->enumerate_surfaces({og.x, og.y});
+    for (auto& child : wf::reverse(children))
+    {
+        auto surface = child.surface->get_wlr_surface();
+        if (!surface || !surface->buffer)
+        {
+            return {};
+        }
+
+        wlr_box box{child.position.x, child.position.y,
+            child.surface->get_size().width, child.surface->get_size().height};
+        result.push_back({wf::texture_t{surface}, box});
+    }
+
+    return result;
+}
+
+static wf::frame_profiler_t *get_frame_profiler(wf::output_t *output)
+{
+    return output ?
+           &static_cast<wf::output_impl_t*>(output)->get_frame_profiler() : nullptr;
+}
+
 bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuffer,
     const wf::region_t& damage)
 {
@@ -1065,15 +1117,33 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
     wf::geometry_t obox = get_untransformed_bounding_box();
     wf::texture_t previous_texture;
     float texture_scale;
+    auto profiler = get_frame_profiler(get_output());
 
-    if (is_mapped() && (enumerate_surfaces().size() == 1) && get_wlr_surface())
+    auto surfaces = is_mapped() ? get_surface_textures(this) :
+        std::vector<surface_texture_t>{};
+    if (surfaces.size() == 1)
     {
         /* Optimized case: there is a single mapped surface.
          * We can directly start with its texture */
-        previous_texture = wf::texture_t{this->get_wlr_surface()};
+        previous_texture = surfaces[0].texture;
         texture_scale    = this->get_wlr_surface()->current.scale;
-    } else
+    } else if (!surfaces.empty() && (view_impl->transforms.size() == 1))
+    {
+        /* Optimized case: a single transformer, which may be able to draw the
+         * surfaces directly, without a snapshot of the view */
+        frame_profiler_t::scope_t scope{profiler, "view-surfaces"};
+        auto& transform = view_impl->transforms.back();
+        if (transform->transform->render_surfaces_with_damage(surfaces,
+            damage & framebuffer.geometry, framebuffer))
+        {
+            view_impl->transforms_damage.clear();
+            return true;
+        }
+    }
+
+    if (surfaces.size() != 1)
     {
+        frame_profiler_t::scope_t scope{profiler, "view-snapshot"};
         take_snapshot();
         previous_texture = wf::texture_t{view_impl->offscreen_buffer.tex};
         texture_scale    = view_impl->offscreen_buffer.scale;
@@ -1090,6 +1160,12 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
     /* final_transform is the one that should render to the screen */
     std::shared_ptr<view_transform_block_t> final_transform = nullptr;
 
+    /* The damaged region of the input of the current transformer. Initially,
+     * this is whatever changed in the view since the transformers' buffers
+     * were last updated. */
+    wf::region_t input_damage = view_impl->transforms_damage & obox;
+    view_impl->transforms_damage.clear();
+
     /* Render the view passing its snapshot through the transformers.
      * For each transformer except the last we render on offscreen buffers,
      * and the last one is rendered to the real fb. */
@@ -1112,20 +1188,36 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
 
         /* Prepare buffer to store result after the transform */
         OpenGL::render_begin();
-        transform->fb.allocate(scaled_width, scaled_height);
+        bool invalidated = transform->fb.allocate(scaled_width, scaled_height);
+        invalidated |= (transform->fb.scale != texture_scale);
+        invalidated |= (transform->fb.geometry != transformed_box);
+
+        /* Repaint only the parts affected by the damage, unless the buffer
+         * contents are no longer valid. */
+        wf::region_t output_damage = invalidated ? wf::region_t{transformed_box} :
+            transform->transform->transform_damage_region(obox, input_damage);
+        output_damage &= transformed_box;
+
         transform->fb.scale    = texture_scale;
         transform->fb.geometry = transformed_box;
         transform->fb.bind(); // bind buffer to clear it
-        OpenGL::clear({0, 0, 0, 0});
+        for (const auto& rect : output_damage)
+        {
+            transform->fb.logic_scissor(wlr_box_from_pixman_box(rect));
+            OpenGL::clear({0, 0, 0, 0});
+        }
+
         OpenGL::render_end();
 
         /* Actually render the transform to the next framebuffer */
+        frame_profiler_t::scope_t scope{profiler, "view-transformer-pass"};
         transform->transform->render_with_damage(previous_texture, obox,
-            wf::region_t{transformed_box}, transform->fb);
+            output_damage, transform->fb);
 
         previous_transform = transform;
         previous_texture   = previous_transform->fb.tex;
         obox = transformed_box;
+        input_damage = std::move(output_damage);
     });
 
     /* This can happen in two ways:
@@ -1138,20 +1230,8 @@ bool wf::view_interface_t::render_transformed(const wf::framebuffer_t& framebuff
     if (final_transform == nullptr)
     {
         OpenGL::render_begin(framebuffer);
-        auto matrix = framebuffer.get_orthographic_projection();
-        gl_geometry src_geometry = {
-            1.0f * obox.x, 1.0f * obox.y,
-            1.0f * obox.x + 1.0f * obox.width,
-            1.0f * obox.y + 1.0f * obox.height,
-        };
-
-        for (const auto& rect : damage)
-        {
-            framebuffer.logic_scissor(wlr_box_from_pixman_box(rect));
-            OpenGL::render_transformed_texture(previous_texture, src_geometry,
-                {}, matrix);
-        }
-
+        OpenGL::render_damaged_texture(previous_texture, framebuffer, obox,
+            damage & framebuffer.geometry);
         OpenGL::render_end();
     } else
     {
@@ -1291,6 +1371,7 @@ void wf::view_interface_t::damage_surface_box(const wlr_box& box)
     damaged.x += obox.x;
     damaged.y += obox.y;
     view_impl->offscreen_buffer.cached_damage |= damaged;
+    view_impl->transforms_damage |= damaged;
     view_damage_raw(self(), transform_region(damaged));
 }
 
@@ -1326,7 +1407,9 @@ void wf::view_damage_raw(wayfire_view view, const wlr_box& box)
         output->render->damage(box);
     }
 
-    view->emit_signal("region-damaged", nullptr);
+    static const wf::signal_id_t region_damaged =
+        wf::get_signal_id("region-damaged");
+    view->emit_signal(region_damaged, nullptr);
 }
 
 void wf::view_interface_t::destruct()
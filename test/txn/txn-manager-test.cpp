@@ -2,6 +2,7 @@
 #include <doctest/doctest.h>
 
 #include <wayfire/compositor-view.hpp>
+#include <chrono>
 #include "../src/core/transaction/transaction-priv.hpp"
 #include "mock-instruction.hpp"
 #include "../mock-core.hpp"
@@ -352,3 +353,115 @@ TEST_CASE("Commit and then apply transaction")
         }
     }
 }
+
+TEST_CASE("Transaction statistics")
+{
+    setup_txn_timeout(100);
+    auto& manager = get_fresh_transaction_manager();
+
+    auto tx = transaction_t::create();
+    auto i_a = new mock_instruction_t("a");
+    auto i_b = new mock_instruction_t("b");
+    tx->add_instruction(instruction_uptr_t(i_a));
+    tx->add_instruction(instruction_uptr_t(i_b));
+
+    auto tx2 = transaction_t::create();
+    tx2->add_instruction(mock_instruction_t::get("a"));
+
+    manager.submit(std::move(tx));
+    manager.submit(std::move(tx2));
+    mock_loop::get().dispatch_idle();
+
+    // Only b is late
+    i_a->send_ready();
+    mock_loop::get().move_forward(100);
+    mock_loop::get().dispatch_idle();
+
+    auto& stats = manager.get_stats();
+    REQUIRE(stats.submitted == 2);
+    REQUIRE(stats.merged == 1);
+    REQUIRE(stats.timed_out == 1);
+    REQUIRE(stats.instructions[2] == 1);
+    REQUIRE(stats.stalled_objects == std::map<std::string, uint64_t>{{"b", 1}});
+}
+
+TEST_CASE("Stalled objects are capped")
+{
+    transaction_stats_t stats;
+    stats.add_stalled_object("often");
+    stats.add_stalled_object("often");
+    for (size_t i = 0; i < 2 * transaction_stats_t::MAX_STALLED_OBJECTS; i++)
+    {
+        stats.add_stalled_object("view-" + std::to_string(i));
+    }
+
+    REQUIRE(stats.stalled_objects.size() ==
+        transaction_stats_t::MAX_STALLED_OBJECTS);
+    REQUIRE(stats.stalled_objects.at("often") == 2);
+}
+
+TEST_CASE("Conflict detection scales with the number of transactions")
+{
+    setup_txn_timeout(100);
+
+    // Like a tiling layout moving many windows at once
+    const int objects_per_tx = 30;
+    std::vector<double> us_per_submit;
+    for (int count : {16, 64, 256, 1024})
+    {
+        auto& manager = get_fresh_transaction_manager();
+        const auto& object = [&] (int tx, int i)
+        {
+            return "bench-" + std::to_string(count) + "-" +
+                   std::to_string(tx * objects_per_tx + i);
+        };
+
+        std::vector<transaction_uptr_t> txs;
+        for (int tx = 0; tx < count; tx++)
+        {
+            txs.push_back(transaction_t::create());
+            for (int i = 0; i < objects_per_tx; i++)
+            {
+                txs.back()->add_instruction(mock_instruction_t::get(object(tx, i)));
+            }
+        }
+
+        // Touches the last object of each of the transactions above
+        auto conflicting = transaction_t::create();
+        for (int tx = 0; tx < count; tx++)
+        {
+            conflicting->add_instruction(
+                mock_instruction_t::get(object(tx, objects_per_tx - 1)));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::set<uint64_t> ids;
+        for (auto& tx : txs)
+        {
+            ids.insert(manager.submit(std::move(tx)));
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        // No transactions were merged
+        REQUIRE(ids.size() == (size_t)count);
+
+        auto conflicting_raw = conflicting.get();
+        auto mega_id = manager.submit(std::move(conflicting));
+        REQUIRE(mega_id == conflicting_raw->get_id());
+        REQUIRE(!ids.count(mega_id));
+
+        // The first transactions are committed, the conflicting one waits
+        mock_loop::get().dispatch_idle();
+
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            end - start).count();
+        us_per_submit.push_back(1.0 * us / count);
+        MESSAGE(count, " transactions: ", us_per_submit.back(), "us per submit");
+    }
+
+    // If each submit checked all pending transactions, a submit with 1024 of
+    // them would be 64 times slower than with 16. Allow some slack for the
+    // timer resolution and for cache effects.
+    REQUIRE(us_per_submit.back() < 8 * us_per_submit.front() + 10);
+}
@@ -0,0 +1,153 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+extern "C"
+{
+#include "wobbly.h"
+
+double wobbly_settings_get_friction()
+{
+    return 3.0;
+}
+
+double wobbly_settings_get_spring_k()
+{
+    return 8.0;
+}
+}
+
+namespace
+{
+struct model_t
+{
+    wobbly_surface surface{};
+
+    model_t(int x, int y)
+    {
+        surface.x     = x;
+        surface.y     = y;
+        surface.width = 400;
+        surface.height   = 300;
+        surface.x_cells  = 8;
+        surface.y_cells  = 8;
+        surface.synced   = 1;
+        wobbly_init(&surface);
+    }
+
+    ~model_t()
+    {
+        wobbly_fini(&surface);
+    }
+
+    /* Grab the model, drag it by (dx, dy) and release it */
+    void fling(int dx, int dy)
+    {
+        wobbly_grab_notify(&surface, surface.x + 10, surface.y + 10);
+        wobbly_move_notify(&surface, surface.x + 10 + dx, surface.y + 10 + dy);
+        wobbly_ungrab_notify(&surface);
+    }
+};
+
+std::vector<std::unique_ptr<model_t>> create_models(int count)
+{
+    std::vector<std::unique_ptr<model_t>> models;
+    for (int i = 0; i < count; i++)
+    {
+        models.push_back(std::make_unique<model_t>(i * 10, i * 5));
+        models.back()->fling(200, 100);
+    }
+
+    return models;
+}
+}
+
+TEST_CASE("Batched stepping matches stepping each model separately")
+{
+    auto batched  = create_models(8);
+    auto separate = create_models(8);
+
+    std::vector<wobbly_surface*> surfaces;
+    for (auto& m : batched)
+    {
+        surfaces.push_back(&m->surface);
+    }
+
+    for (int frame = 0; frame < 100; frame++)
+    {
+        wobbly_prepare_paint_batch(surfaces.data(), surfaces.size(), 16);
+        for (auto& m : separate)
+        {
+            wobbly_prepare_paint(&m->surface, 16);
+        }
+    }
+
+    for (size_t i = 0; i < batched.size(); i++)
+    {
+        auto a = wobbly_boundingbox(&batched[i]->surface);
+        auto b = wobbly_boundingbox(&separate[i]->surface);
+        REQUIRE(a.tlx == b.tlx);
+        REQUIRE(a.tly == b.tly);
+        REQUIRE(a.brx == b.brx);
+        REQUIRE(a.bry == b.bry);
+    }
+}
+
+TEST_CASE("Model settles at the same place regardless of the frame rate")
+{
+    model_t slow{0, 0}, fast{0, 0};
+    slow.fling(200, 100);
+    fast.fling(200, 100);
+
+    for (int frame = 0; frame < 1000 && !slow.surface.synced; frame++)
+    {
+        wobbly_prepare_paint(&slow.surface, 30);
+    }
+
+    for (int frame = 0; frame < 4000 && !fast.surface.synced; frame++)
+    {
+        wobbly_prepare_paint(&fast.surface, 7);
+    }
+
+    REQUIRE(slow.surface.synced);
+    REQUIRE(fast.surface.synced);
+    CHECK(slow.surface.x == doctest::Approx(fast.surface.x).epsilon(0.01));
+    CHECK(slow.surface.y == doctest::Approx(fast.surface.y).epsilon(0.01));
+}
+
+TEST_CASE("Benchmark stepping N models")
+{
+    for (int count : {1, 16, 64, 256})
+    {
+        auto models = create_models(count);
+        std::vector<wobbly_surface*> surfaces;
+        for (auto& m : models)
+        {
+            surfaces.push_back(&m->surface);
+        }
+
+        const int frames = 100;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            /* Keep the models moving for the whole benchmark */
+            if (frame % 20 == 0)
+            {
+                for (auto& m : models)
+                {
+                    wobbly_slight_wobble(&m->surface);
+                }
+            }
+
+            wobbly_prepare_paint_batch(surfaces.data(), surfaces.size(), 16);
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        auto us  = std::chrono::duration_cast<std::chrono::microseconds>(
+            end - start).count();
+        MESSAGE(count, " models: ", 1.0 * us / frames, "us per frame");
+    }
+}